@@ -0,0 +1,2187 @@
+// bench.c : Throughput benchmarks for the Heap / PQueue implementation in Heap-PQueue.c
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Usage: Heap-PQueue-Bench [n] [--suite] [--json]
+//
+//   n        elements, default 1000000; the arity sweep runs 1K, 10K, ... up to n,
+//            so pass 100000000 for the full 1K..100M range
+//   --suite  run only the suite: heap, pqueue, std::priority_queue, parcels (plain
+//            and stable) and cqueue through insert / peek / extract / hold, for
+//            random, sorted, reverse and duplicate-heavy keys, at 10, 100, ... n
+//   --json   print every result as one JSON array of records instead of text
+//
+// Every benchmark prints one line:  <name>  n=<elements>  <ops/sec>
+// (latency runs print ns per round trip instead).
+// Keys come from a fixed-seed xorshift generator so runs are reproducible.
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+#include "heap.h"
+#include "heapsimd.h"
+#include "heapt.h"
+#include "pqueue.h"
+
+#include "cqueue.h"
+#include "parcel.h"
+#include "parcels.h"
+#include "radixheap.h"
+#include "bucketqueue.h"
+#include "extheap.h"
+#include "parcelwal.h"
+#include "timingwheel.h"
+#include "losertree.h"
+#include "mpmcqueue.h"
+#include "spscqueue.h"
+#include "pool.h"
+#include "latency.h"
+#include "qatomic.h"
+
+#include "bench_std.h"
+
+///////////////////////
+// Bench Utilities
+///////////////////////
+
+static double bench_now(void) {                                                     // Wall clock in seconds.
+
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+static unsigned int bench_seed = 2463534242u;
+
+static int bench_rand(void) {                                                       // xorshift32, fixed seed.
+
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return (int)(bench_seed >> 1);
+}
+
+static int bench_json;                                                              // --json: results form one JSON array
+static int bench_records;                                                           // JSON records printed so far
+static const char* bench_group = "";                                                // JSON group of the indented rows that follow
+
+static void bench_record(void) {                                                    // Open the next JSON record.
+
+    fprintf(stdout, "%s\n  { ", bench_records++ == 0 ? "[" : ",");
+}
+
+static void bench_section(const char* name) {                                       // Heading for the indented rows below it.
+
+    if (bench_json)
+        bench_group = name;
+    else
+        fprintf(stdout, "%s\n", name);
+}
+
+static void bench_report(const char* name, int n, long long ops, double secs) {
+
+    int grouped = name[0] == ' ';
+
+    if (!bench_json) {
+        fprintf(stdout, "%-36s n=%-10d %14.0f ops/sec\n", name, n, secs > 0 ? ops / secs : 0.0);
+        return;
+    }
+
+    while (*name == ' ')
+        name++;
+    bench_record();
+    fprintf(stdout, "\"group\": \"%s\", \"name\": \"%s\", \"n\": %d, \"ops\": %lld, \"secs\": %.6f, \"ops_per_sec\": %.0f }",
+        grouped ? bench_group : "", name, n, ops, secs, secs > 0 ? ops / secs : 0.0);
+}
+
+static void bench_report_latency(const char* name, int n, double secs) {           // n round trips in secs.
+
+    if (!bench_json) {
+        fprintf(stdout, "%-36s n=%-10d %14.0f ns/round trip\n", name, n, secs * 1e9 / n);
+        return;
+    }
+
+    bench_record();
+    fprintf(stdout, "\"group\": \"\", \"name\": \"%s\", \"n\": %d, \"secs\": %.6f, \"ns_per_op\": %.1f }",
+        name, n, secs, secs * 1e9 / n);
+}
+
+///////////////////////
+// Bench Threads
+///////////////////////
+
+#ifdef _WIN32
+typedef HANDLE BenchThread;
+typedef CRITICAL_SECTION BenchMutex;
+#define BENCH_THREAD(name) static DWORD WINAPI name(LPVOID arg)
+#define BENCH_THREAD_RETURN return 0
+#define bench_thread_start(thread, fn, arg) ((*(thread) = CreateThread(NULL, 0, (fn), (arg), 0, NULL)) != NULL ? 0 : -1)
+#define bench_thread_join(thread) (WaitForSingleObject((thread), INFINITE), CloseHandle(thread))
+#define bench_yield() SwitchToThread()
+#define bench_mutex_init(mutex) InitializeCriticalSection(mutex)
+#define bench_mutex_destroy(mutex) DeleteCriticalSection(mutex)
+#define bench_mutex_lock(mutex) EnterCriticalSection(mutex)
+#define bench_mutex_unlock(mutex) LeaveCriticalSection(mutex)
+#else
+typedef pthread_t BenchThread;
+typedef pthread_mutex_t BenchMutex;
+#define BENCH_THREAD(name) static void* name(void* arg)
+#define BENCH_THREAD_RETURN return NULL
+#define bench_thread_start(thread, fn, arg) (pthread_create((thread), NULL, (fn), (arg)) == 0 ? 0 : -1)
+#define bench_thread_join(thread) pthread_join((thread), NULL)
+#define bench_yield() sched_yield()
+#define bench_mutex_init(mutex) pthread_mutex_init((mutex), NULL)
+#define bench_mutex_destroy(mutex) pthread_mutex_destroy(mutex)
+#define bench_mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define bench_mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#endif
+
+static void bench_backoff(int* spin) {                                               // Spin briefly, then let the other thread run.
+
+    if (++*spin % 256 != 0)
+        qatomic_pause();
+    else
+        bench_yield();
+}
+
+static int compare_int(const void* int1, const void* int2) {
+
+    if (*(const int*)int1 > *(const int*)int2)
+        return 1;
+    else if (*(const int*)int1 < *(const int*)int2)
+        return -1;
+    else
+        return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Legacy heap: the original realloc-per-operation insert/extract, kept here
+// as the "before" baseline for the capacity-managed heap.
+/////////////////////////////////////////////////////////////////////////////
+
+static int legacy_insert(Heap* heap, const void* data) {
+
+    void* temp;
+    int ipos, ppos;
+
+    if ((temp = (void**)realloc(heap->tree, (heap->size + 1) * sizeof(void*))) == NULL)
+        return -1;
+    heap->tree = temp;
+
+    heap->tree[heap->size] = (void*)data;
+
+    ipos = heap->size;
+    ppos = (ipos - 1) / 2;
+
+    while (ipos > 0 && heap->compare(heap->tree[ppos], heap->tree[ipos]) < 0) {
+
+        temp = heap->tree[ppos];
+        heap->tree[ppos] = heap->tree[ipos];
+        heap->tree[ipos] = temp;
+
+        ipos = ppos;
+        ppos = (ipos - 1) / 2;
+    }
+
+    heap->size++;
+    return 0;
+}
+
+static int legacy_extract(Heap* heap, void** data) {
+
+    void* save;
+    void* temp;
+    int ipos, lpos, rpos, mpos;
+
+    if (heap->size == 0)
+        return -1;
+
+    *data = heap->tree[0];
+    save = heap->tree[heap->size - 1];
+
+    if (heap->size - 1 > 0) {
+
+        if ((temp = (void**)realloc(heap->tree, (heap->size - 1) * sizeof(void*))) == NULL)
+            return -1;
+        heap->tree = temp;
+        heap->size--;
+
+    } else {
+
+        free(heap->tree);
+        heap->tree = NULL;
+        heap->size = 0;
+        return 0;
+    }
+
+    heap->tree[0] = save;
+    ipos = 0;
+
+    while (1) {
+
+        lpos = ipos * 2 + 1;
+        rpos = ipos * 2 + 2;
+
+        mpos = (lpos < heap->size && heap->compare(heap->tree[lpos], heap->tree[ipos]) > 0) ? lpos : ipos;
+
+        if (rpos < heap->size && heap->compare(heap->tree[rpos], heap->tree[mpos]) > 0)
+            mpos = rpos;
+
+        if (mpos == ipos)
+            break;
+
+        temp = heap->tree[mpos];
+        heap->tree[mpos] = heap->tree[ipos];
+        heap->tree[ipos] = temp;
+        ipos = mpos;
+    }
+
+    return 0;
+}
+
+static void legacy_destroy(Heap* heap) {
+
+    free(heap->tree);
+    memset(heap, 0, sizeof(Heap));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// Legacy circular queue: the original malloc-per-node linked ring, kept here
+// as the "before" baseline for the array-backed ring in cqueue.h.
+/////////////////////////////////////////////////////////////////////////////
+
+struct LegacyNode {
+    int data;
+    struct LegacyNode* next;
+};
+
+struct LegacyQueue {
+    struct LegacyNode* front;
+    struct LegacyNode* rear;
+};
+
+static void legacy_enQueue(struct LegacyQueue* q, int value) {
+
+    struct LegacyNode* pnew = (struct LegacyNode*)malloc(sizeof(struct LegacyNode));
+    pnew->data = value;
+
+    if (q->front == NULL)
+        q->front = pnew;
+    else
+        q->rear->next = pnew;
+
+    q->rear = pnew;
+    q->rear->next = q->front;
+}
+
+static int legacy_deQueue(struct LegacyQueue* q) {
+
+    struct LegacyNode* cur = q->front;
+    int value = cur->data;
+
+    if (q->front == q->rear) {
+        q->front = NULL;
+        q->rear = NULL;
+    }
+    else {
+        q->front = q->front->next;
+        q->rear->next = q->front;
+    }
+
+    free(cur);
+    return value;
+}
+
+///////////////////////
+// Benchmarks
+///////////////////////
+
+static void bench_heap_fill_drain(const char* name, int* keys, int n,
+    int (*insert)(Heap* heap, const void* data), int (*extract)(Heap* heap, void** data), void (*destroy)(Heap* heap)) {
+
+    Heap heap;
+    void* data;
+    double t0, t1, t2;
+    int i;
+
+    heap_init(&heap, compare_int, NULL);
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        insert(&heap, &keys[i]);
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        extract(&heap, &data);
+    t2 = bench_now();
+
+    bench_section(name);
+    bench_report("  insert", n, n, t1 - t0);
+    bench_report("  extract", n, n, t2 - t1);
+    bench_report("  insert+extract", n, 2LL * n, t2 - t0);
+
+    destroy(&heap);
+}
+
+static void bench_heap_hold(const char* name, int* keys, int n, int rounds,
+    int (*insert)(Heap* heap, const void* data), int (*extract)(Heap* heap, void** data), void (*destroy)(Heap* heap)) {
+
+    Heap heap;
+    void* data;
+    double t0;
+    int i;
+
+    heap_init(&heap, compare_int, NULL);
+
+    for (i = 0; i < n; i++)                                                         // Steady state: size stays at n while we alternate.
+        insert(&heap, &keys[i]);
+
+    t0 = bench_now();
+    for (i = 0; i < rounds; i++) {
+        extract(&heap, &data);
+        insert(&heap, data);
+    }
+    bench_report(name, n, 2LL * rounds, bench_now() - t0);
+
+    destroy(&heap);
+}
+
+static int compare_parcel(const void* parcel1, const void* parcel2) {
+
+    if (((const Parcel*)parcel1)->priority > ((const Parcel*)parcel2)->priority)
+        return 1;
+    else if (((const Parcel*)parcel1)->priority < ((const Parcel*)parcel2)->priority)
+        return -1;
+    else
+        return 0;
+}
+
+static void bench_parcels(const char* name, PQueue* parcels, int* keys, int n) {
+
+    Parcel parcel;
+    double t0, t1, t2;
+    int i;
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        put_parcel(parcels, &parcel);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        get_parcel(parcels, &parcel);
+    t2 = bench_now();
+
+    bench_section(name);
+    bench_report("  put_parcel", n, n, t1 - t0);
+    bench_report("  get_parcel", n, n, t2 - t1);
+
+    pqueue_destroy(parcels);
+}
+
+static void bench_sized_fill_drain(const char* name, int* keys, int n) {             // Heap with compare_int through the function pointer.
+
+    Heap heap;
+    int value;
+    double t0, t1, t2;
+    int i;
+
+    heap_init_sized(&heap, sizeof(int), compare_int);
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        heap_insert(&heap, &keys[i]);
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        heap_extract(&heap, (void**)&value);
+    t2 = bench_now();
+
+    bench_section(name);
+    bench_report("  insert", n, n, t1 - t0);
+    bench_report("  extract", n, n, t2 - t1);
+
+    heap_destroy(&heap);
+}
+
+static void bench_intheap_fill_drain(const char* name, int* keys, int n) {           // IntHeap from heapt.h, comparison inlined.
+
+    IntHeap heap;
+    int value;
+    double t0, t1, t2;
+    int i;
+
+    intheap_init(&heap);
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        intheap_insert(&heap, &keys[i]);
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        intheap_extract(&heap, &value);
+    t2 = bench_now();
+
+    bench_section(name);
+    bench_report("  insert", n, n, t1 - t0);
+    bench_report("  extract", n, n, t2 - t1);
+
+    intheap_destroy(&heap);
+}
+
+static void bench_parcel_heap(const char* name, int* keys, int n) {
+
+    ParcelHeap heap;
+    Parcel parcel;
+    double t0, t1, t2;
+    int i;
+
+    parcel_heap_init(&heap);
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        parcel_heap_insert(&heap, &parcel);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        parcel_heap_extract(&heap, &parcel);
+    t2 = bench_now();
+
+    bench_section(name);
+    bench_report("  insert", n, n, t1 - t0);
+    bench_report("  extract", n, n, t2 - t1);
+
+    parcel_heap_destroy(&heap);
+}
+
+static void bench_arity_sweep(int* keys, int n) {                                 // d-ary vs binary, 1K .. n elements.
+
+    static const int arities[] = { 2, 4, 8 };
+    char name[64];
+    Heap heap;
+    int value;
+    int size;
+    double t0, t1, t2;
+    int a, i;
+
+    for (size = 1000; size <= n; size *= 10) {
+
+        for (a = 0; a < (int)(sizeof(arities) / sizeof(arities[0])); a++) {
+
+            heap_init_sized(&heap, sizeof(int), compare_int);
+            heap_set_arity(&heap, arities[a]);
+
+            t0 = bench_now();
+            for (i = 0; i < size; i++)
+                heap_insert(&heap, &keys[i]);
+            t1 = bench_now();
+            for (i = 0; i < size; i++)
+                heap_extract(&heap, (void**)&value);
+            t2 = bench_now();
+
+            sprintf(name, "%d-ary insert", arities[a]);
+            bench_report(name, size, size, t1 - t0);
+            sprintf(name, "%d-ary extract", arities[a]);
+            bench_report(name, size, size, t2 - t1);
+
+            heap_destroy(&heap);
+        }
+    }
+}
+
+static void bench_parcel_extract(const char* name, Heap* heap, int* keys, int n) {  // extract-max on the Parcel::priority workload.
+
+    Parcel parcel;
+    double t0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        heap_insert(heap, &parcel);
+    }
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        heap_extract(heap, (void**)&parcel);
+    bench_report(name, n, n, bench_now() - t0);
+
+    heap_destroy(heap);
+}
+
+static void bench_simd_select(int* keys, int n) {
+
+    static const int arities[] = { 8, 16 };
+    static const char* levels[] = { "scalar", "sse4.1", "avx2" };
+    char name[64];
+    Heap heap;
+    int a, level;
+
+    for (a = 0; a < (int)(sizeof(arities) / sizeof(arities[0])); a++) {
+
+        heap_init_sized(&heap, sizeof(Parcel), compare_parcel);
+        heap_set_arity(&heap, arities[a]);
+        sprintf(name, "%d-ary extract, compare()", arities[a]);
+        bench_parcel_extract(name, &heap, keys, n);
+
+        for (level = HEAP_SIMD_NONE; level <= HEAP_SIMD_AVX2; level++) {
+
+            if (heap_simd_set_level(level) != level)                               // CPU lacks this level.
+                continue;
+
+            heap_init_keyed(&heap, sizeof(Parcel), HEAP_KEY_I32);
+            heap_set_arity(&heap, arities[a]);
+            sprintf(name, "%d-ary extract, keyed %s", arities[a], levels[level]);
+            bench_parcel_extract(name, &heap, keys, n);
+        }
+
+        heap_simd_set_level(HEAP_SIMD_AVX2);
+    }
+}
+
+// n x put_parcel vs one load_parcels vs restoring a pqueue_save snapshot (checksum
+// pass included; the file is likely still in the page cache).
+static void bench_cold_start(int* keys, int n) {
+
+    static const char* const path = "bench-cold-start.snapshot";
+    PQueue parcels;
+    Parcel* items;
+    Parcel parcel;
+    double t0;
+    int i;
+
+    if ((items = (Parcel*)malloc(n * sizeof(Parcel))) == NULL)
+        return;
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        put_parcel(&parcels, &items[i]);
+    bench_report("cold start, put_parcel loop", n, n, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    load_parcels(&parcels, items, n);
+    bench_report("cold start, load_parcels", n, n, bench_now() - t0);
+
+    t0 = bench_now();
+    if (pqueue_save(&parcels, path) == 0)
+        bench_report("cold start, pqueue_save", n, n, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    if (pqueue_load(&parcels, path) == 0) {
+        bench_report("cold start, pqueue_load", n, n, bench_now() - t0);
+        t0 = bench_now();
+        for (i = 0; i < n; i++)                                                     // Extracts touch the adopted pages.
+            get_parcel(&parcels, &parcel);
+        bench_report("cold start, drain after pqueue_load", n, n, bench_now() - t0);
+    }
+    pqueue_destroy(&parcels);
+    remove(path);
+
+    free(items);
+}
+
+static void bench_batch_dispatch(int* keys, int n, int batch) {                      // Per-parcel vs batched put/get.
+
+    PQueue parcels;
+    Parcel* items;
+    char name[64];
+    double t0, t1, t2;
+    int i;
+
+    if ((items = (Parcel*)malloc(n * sizeof(Parcel))) == NULL)
+        return;
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        put_parcel(&parcels, &items[i]);
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        get_parcel(&parcels, &items[i]);
+    t2 = bench_now();
+    bench_report("put_parcel x1", n, n, t1 - t0);
+    bench_report("get_parcel x1", n, n, t2 - t1);
+    pqueue_destroy(&parcels);
+
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i += batch)
+        put_parcels(&parcels, &items[i], n - i < batch ? n - i : batch);
+    t1 = bench_now();
+    for (i = 0; i < n; i += batch)
+        get_parcels(&parcels, &items[i], batch);
+    t2 = bench_now();
+    sprintf(name, "put_parcels x%d", batch);
+    bench_report(name, n, n, t1 - t0);
+    sprintf(name, "get_parcels x%d", batch);
+    bench_report(name, n, n, t2 - t1);
+    pqueue_destroy(&parcels);
+
+    free(items);
+}
+
+////////////////
+// MAINLINE
+////////////////
+static void bench_reprioritize(int* keys, int n, int updates) {                      // Handle-based update vs drain, patch and reload.
+
+    PQueue parcels;
+    Parcel* items;
+    int* handles;
+    double t0;
+    int i, j, count;
+
+    if ((items = (Parcel*)malloc(n * sizeof(Parcel))) == NULL)
+        return;
+    if ((handles = (int*)malloc(n * sizeof(int))) == NULL) {
+        free(items);
+        return;
+    }
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        put_parcel(&parcels, &items[i]);
+    bench_report("put_parcel (no handles)", n, n, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        put_parcel_handle(&parcels, &items[i], &handles[i]);
+    bench_report("put_parcel_handle", n, n, bench_now() - t0);
+
+    t0 = bench_now();
+    for (i = 0; i < updates; i++)
+        reprioritize_parcel(&parcels, handles[(keys[i] & 0x7fffffff) % n], keys[(i + 1) % n]);
+    bench_report("reprioritize_parcel", n, updates, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    updates = 10;                                                                   // O(n) per update: a handful is enough.
+    parcels_init(&parcels);
+    load_parcels(&parcels, items, n);
+    t0 = bench_now();
+    for (i = 0; i < updates; i++) {
+        count = get_parcels(&parcels, items, n);
+        for (j = 0; j < count && items[j].priority != keys[i]; j++)
+            ;
+        if (j < count)
+            items[j].priority = keys[(i + 1) % n];
+        load_parcels(&parcels, items, count);
+    }
+    bench_report("reprioritize by drain + reload", n, updates, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    free(handles);
+    free(items);
+}
+
+static int bench_heap_put(void* queue, const void* data) { return heap_insert((Heap*)queue, data); }
+
+static int bench_heap_get(void* queue, void** data) { return heap_extract((Heap*)queue, data); }
+
+static int bench_radix_put(void* queue, const void* data) { return radix_insert((RadixHeap*)queue, data); }
+
+static int bench_radix_get(void* queue, void** data) { return radix_extract((RadixHeap*)queue, data); }
+
+static int bench_bucket_put(void* queue, const void* data) { return bucket_insert((BucketQueue*)queue, data); }
+
+static int bench_bucket_get(void* queue, void** data) { return bucket_extract((BucketQueue*)queue, data); }
+
+static int bench_extheap_put(void* queue, const void* data) { return extheap_insert((ExtHeap*)queue, data); }
+
+static int bench_extheap_get(void* queue, void** data) { return extheap_extract((ExtHeap*)queue, data); }
+
+// Monotone hold model on int64 keys: preload n keys, then n rounds of "extract the
+// top key, insert one at most span below it" (Dijkstra-style). 64 bits keep n * span
+// from wrapping at any n.
+static void bench_monotone_hold(const char* name, void* queue, int* keys, int n, int span,
+    int (*put)(void* queue, const void* data), int (*get)(void* queue, void** data)) {
+
+    long long key;
+    double t0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        key = -(long long)((keys[i] & 0x7fffffff) % span);
+        put(queue, &key);
+    }
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        get(queue, (void**)&key);
+        key -= (keys[i] & 0x7fffffff) % span;
+        put(queue, &key);
+    }
+    bench_report(name, n, n, bench_now() - t0);
+}
+
+static void bench_radix(int* keys, int n) {                                           // Radix heap vs keyed heap on monotone workloads.
+
+    Heap heap;
+    RadixHeap radix;
+    static const int spans[] = { 256, 1 << 16, 1 << 24 };
+    char name[64];
+    int span;
+    int i;
+
+    for (i = 0; i < (int)(sizeof(spans) / sizeof(spans[0])); i++) {
+
+        span = spans[i];
+
+        heap_init_keyed(&heap, sizeof(long long), HEAP_KEY_I64);
+        sprintf(name, "monotone hold, heap  span=%d", span);
+        bench_monotone_hold(name, &heap, keys, n, span, bench_heap_put, bench_heap_get);
+        heap_destroy(&heap);
+
+        radix_init_keyed(&radix, sizeof(long long), HEAP_KEY_I64);
+        sprintf(name, "monotone hold, radix span=%d", span);
+        bench_monotone_hold(name, &radix, keys, n, span, bench_radix_put, bench_radix_get);
+        radix_destroy(&radix);
+    }
+}
+
+// Parcels with priorities 0 .. 255: fill / drain, then a hold model at n parcels.
+static void bench_small_range(const char* name, void* queue, int* keys, int n,
+    int (*put)(void* queue, const void* data), int (*get)(void* queue, void** data)) {
+
+    Parcel parcel;
+    char label[64];
+    double t0, t1, t2;
+    int i;
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i] & 0xff;
+        put(queue, &parcel);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        get(queue, (void**)&parcel);
+    t2 = bench_now();
+    sprintf(label, "%s put", name);
+    bench_report(label, n, n, t1 - t0);
+    sprintf(label, "%s get", name);
+    bench_report(label, n, n, t2 - t1);
+
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i] & 0xff;
+        put(queue, &parcel);
+    }
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        get(queue, (void**)&parcel);
+        parcel.priority = keys[n - 1 - i] & 0xff;
+        put(queue, &parcel);
+    }
+    sprintf(label, "%s hold", name);
+    bench_report(label, n, n, bench_now() - t0);
+}
+
+static void bench_bucket(int* keys, int n) {                                          // Bucket queue vs keyed heap, priorities 0 .. 255.
+
+    Heap heap;
+    BucketQueue* bucket;
+
+    heap_init_keyed(&heap, sizeof(Parcel), HEAP_KEY_I32);
+    bench_small_range("0..255, keyed heap", &heap, keys, n, bench_heap_put, bench_heap_get);
+    heap_destroy(&heap);
+
+    if ((bucket = (BucketQueue*)malloc(sizeof(BucketQueue))) == NULL)               // 6 KB of ring headers: keep it off the stack.
+        return;
+    bucket_init_keyed(bucket, sizeof(Parcel), HEAP_KEY_I32);
+    bench_small_range("0..255, bucket queue", bucket, keys, n, bench_bucket_put, bench_bucket_get);
+    bucket_destroy(bucket);
+    free(bucket);
+}
+
+// A backlog of n parcels: fill, then drain, then a hold model at n parcels.
+static void bench_backlog(const char* name, void* queue, int* keys, int n,
+    int (*put)(void* queue, const void* data), int (*get)(void* queue, void** data)) {
+
+    Parcel parcel;
+    char label[64];
+    double t0, t1, t2;
+    int i;
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        put(queue, &parcel);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++)
+        get(queue, (void**)&parcel);
+    t2 = bench_now();
+    sprintf(label, "%s put", name);
+    bench_report(label, n, n, t1 - t0);
+    sprintf(label, "%s get", name);
+    bench_report(label, n, n, t2 - t1);
+
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        put(queue, &parcel);
+    }
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        get(queue, (void**)&parcel);
+        parcel.priority = keys[n - 1 - i];
+        put(queue, &parcel);
+    }
+    sprintf(label, "%s hold", name);
+    bench_report(label, n, n, bench_now() - t0);
+}
+
+static void bench_extheap(int* keys, int n) {                                         // In-memory keyed heap vs external heap
+                                                                                      // holding 1/1, 1/16 and 1/256 of the backlog.
+    static const int fractions[] = { 1, 16, 256 };
+    Heap heap;
+    ExtHeap ext;
+    char name[64];
+    int i;
+
+    heap_init_keyed(&heap, sizeof(Parcel), HEAP_KEY_I32);
+    bench_backlog("backlog, keyed heap", &heap, keys, n, bench_heap_put, bench_heap_get);
+    heap_destroy(&heap);
+
+    for (i = 0; i < (int)(sizeof(fractions) / sizeof(fractions[0])); i++) {
+
+        extheap_init_keyed(&ext, sizeof(Parcel), HEAP_KEY_I32);
+        if (extheap_set_limit(&ext, n / fractions[i] > EXTHEAP_MIN_LIMIT ? n / fractions[i] : EXTHEAP_MIN_LIMIT) != 0)
+            return;
+        sprintf(name, "backlog, extheap 1/%d", fractions[i]);
+        bench_backlog(name, &ext, keys, n, bench_extheap_put, bench_extheap_get);
+        if (!bench_json)
+            fprintf(stdout, "    runs written=%lld merges=%lld\n", ext.spills, ext.merges);
+        extheap_destroy(&ext);
+    }
+}
+
+static void bench_cqueue(int* keys, int n, int ops, int burst) {                       // Linked vs ring queue, bursts of enqueues then dequeues.
+
+    struct LegacyQueue lq = { NULL, NULL };
+    struct Queue q;
+    int* buf;
+    char name[64];
+    double t0;
+    unsigned int sink = 0;
+    int done, i;
+
+    if ((buf = (int*)malloc(burst * sizeof(int))) == NULL)
+        return;
+
+    t0 = bench_now();
+    for (done = 0; done < ops; done += 2 * burst) {
+        for (i = 0; i < burst; i++)
+            legacy_enQueue(&lq, keys[(done + i) % n]);
+        for (i = 0; i < burst; i++)
+            sink += legacy_deQueue(&lq);
+    }
+    sprintf(name, "cqueue linked, burst %d", burst);
+    bench_report(name, n, done, bench_now() - t0);
+
+    initQueue(&q);
+    t0 = bench_now();
+    for (done = 0; done < ops; done += 2 * burst) {
+        for (i = 0; i < burst; i++)
+            enQueue(&q, keys[(done + i) % n]);
+        for (i = 0; i < burst; i++)
+            sink += deQueue(&q);
+    }
+    sprintf(name, "cqueue ring, burst %d", burst);
+    bench_report(name, n, done, bench_now() - t0);
+
+    t0 = bench_now();
+    for (done = 0; done < ops; done += 2 * burst) {
+        for (i = 0; i < burst; i++)
+            buf[i] = keys[(done + i) % n];
+        enQueue_n(&q, buf, burst);
+        deQueue_n(&q, buf, burst);
+        sink += buf[0];
+    }
+    sprintf(name, "cqueue ring _n, burst %d", burst);
+    bench_report(name, n, done, bench_now() - t0);
+    destroyQueue(&q);
+
+    if (sink == 42)                                                                 // Keep the dequeued values alive.
+        fprintf(stdout, " ");
+    free(buf);
+}
+
+// MPMC scaling: t producers push items / t values each while t consumers drain until
+// all items are through. A full or empty queue makes the thread yield and retry.
+struct BenchMPMC {
+    struct MPMCQueue* mpmc;                                                         // lock-free ring, or
+    struct Queue* ring;                                                             // the cqueue ring behind one mutex
+    BenchMutex* mutex;
+    int per_thread;
+    unsigned int consumed;
+    int items;
+};
+
+static int bench_mpmc_put(struct BenchMPMC* b, int value) {
+
+    int rc;
+
+    if (b->mpmc != NULL)
+        return enQueue_mpmc(b->mpmc, value);
+
+    bench_mutex_lock(b->mutex);
+    rc = queueSize(b->ring) < 1024 ? enQueue(b->ring, value) : -1;                  // Same bound as the lock-free ring.
+    bench_mutex_unlock(b->mutex);
+    return rc;
+}
+
+static int bench_mpmc_get(struct BenchMPMC* b, int* value) {
+
+    int rc = -1;
+
+    if (b->mpmc != NULL)
+        return deQueue_mpmc(b->mpmc, value);
+
+    bench_mutex_lock(b->mutex);
+    if (queueSize(b->ring) > 0) {
+        *value = deQueue(b->ring);
+        rc = 0;
+    }
+    bench_mutex_unlock(b->mutex);
+    return rc;
+}
+
+BENCH_THREAD(bench_mpmc_producer) {
+
+    struct BenchMPMC* b = (struct BenchMPMC*)arg;
+    int i;
+
+    for (i = 0; i < b->per_thread; i++) {
+        while (bench_mpmc_put(b, i) != 0)
+            bench_yield();
+    }
+
+    BENCH_THREAD_RETURN;
+}
+
+BENCH_THREAD(bench_mpmc_consumer) {
+
+    struct BenchMPMC* b = (struct BenchMPMC*)arg;
+    int value;
+
+    while ((int)qatomic_load_relaxed(&b->consumed) < b->items) {
+        if (bench_mpmc_get(b, &value) == 0)
+            qatomic_fetch_add(&b->consumed, 1);
+        else
+            bench_yield();
+    }
+
+    BENCH_THREAD_RETURN;
+}
+
+static void bench_mpmc(int items, int max_threads) {
+
+    struct MPMCQueue* mpmc;
+    struct Queue ring;
+    BenchMutex mutex;
+    struct BenchMPMC b;
+    BenchThread threads[2 * 64];
+    char name[64];
+    double t0;
+    int locked;
+    int t, i;
+
+    if ((mpmc = (struct MPMCQueue*)malloc(sizeof(struct MPMCQueue))) == NULL || initQueue_mpmc(mpmc, 1024) != 0) {
+        free(mpmc);
+        return;
+    }
+    initQueue(&ring);
+    bench_mutex_init(&mutex);
+
+    for (t = 1; t <= max_threads && t <= 64; t *= 2) {
+        for (locked = 0; locked < 2; locked++) {
+
+            b.mpmc = locked ? NULL : mpmc;
+            b.ring = &ring;
+            b.mutex = &mutex;
+            b.per_thread = items / t;
+            b.items = b.per_thread * t;
+            b.consumed = 0;
+
+            t0 = bench_now();
+            for (i = 0; i < t; i++) {
+                bench_thread_start(&threads[2 * i], bench_mpmc_producer, &b);
+                bench_thread_start(&threads[2 * i + 1], bench_mpmc_consumer, &b);
+            }
+            for (i = 0; i < 2 * t; i++)
+                bench_thread_join(threads[i]);
+
+            sprintf(name, "%s %dP/%dC", locked ? "cqueue + mutex" : "mpmc lock-free", t, t);
+            bench_report(name, b.items, b.items, bench_now() - t0);
+        }
+    }
+
+    bench_mutex_destroy(&mutex);
+    destroyQueue(&ring);
+    destroyQueue_mpmc(mpmc);
+    free(mpmc);
+}
+
+// SPSC throughput: one producer thread streams items ints to one consumer, one value
+// per call or bulk chunks per call. A full or empty ring makes the thread yield.
+struct BenchSPSC {
+    struct SPSCQueue* q;
+    struct SPSCQueue* back;                                                         // reply ring for the ping-pong latency run
+    int items;
+    int chunk;                                                                      // 0 = enQueue_spsc / deQueue_spsc per value
+};
+
+BENCH_THREAD(bench_spsc_producer) {
+
+    struct BenchSPSC* b = (struct BenchSPSC*)arg;
+    int buf[256];
+    int i = 0;
+    int k, c;
+
+    while (i < b->items) {
+        if (b->chunk == 0) {
+            if (enQueue_spsc(b->q, i) == 0)
+                i++;
+            else
+                bench_yield();
+        }
+        else {
+            for (k = 0; k < b->chunk && i + k < b->items; k++)
+                buf[k] = i + k;
+            if ((c = enQueue_spsc_n(b->q, buf, k)) == 0)
+                bench_yield();
+            i += c;
+        }
+    }
+    flushQueue_spsc(b->q);
+
+    BENCH_THREAD_RETURN;
+}
+
+BENCH_THREAD(bench_spsc_echo) {                                                     // Send every value straight back.
+
+    struct BenchSPSC* b = (struct BenchSPSC*)arg;
+    int spin = 0;
+    int value;
+    int i;
+
+    for (i = 0; i < b->items; i++) {
+        while (deQueue_spsc(b->q, &value) != 0)
+            bench_backoff(&spin);
+        while (enQueue_spsc(b->back, value) != 0)
+            bench_backoff(&spin);
+    }
+
+    BENCH_THREAD_RETURN;
+}
+
+static void bench_spsc(int items) {
+
+    static const int batches[] = { 1, 64 };
+    struct SPSCQueue* q;
+    struct SPSCQueue* back;
+    struct BenchSPSC b;
+    BenchThread thread;
+    int buf[256];
+    char name[64];
+    double t0;
+    long long sink = 0;
+    int spin = 0;
+    int got, c, i, value;
+
+    q = (struct SPSCQueue*)malloc(sizeof(struct SPSCQueue));
+    back = (struct SPSCQueue*)malloc(sizeof(struct SPSCQueue));
+    if (q == NULL || back == NULL) {
+        free(q);
+        free(back);
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {                                                       // batch 1, batch 64, then bulk chunks of 256.
+
+        initQueue_spsc(q, 4096, i < 2 ? batches[i] : 64);
+        b.q = q;
+        b.items = items;
+        b.chunk = i < 2 ? 0 : 256;
+
+        t0 = bench_now();
+        bench_thread_start(&thread, bench_spsc_producer, &b);
+        for (got = 0; got < items; ) {
+            if (b.chunk == 0) {
+                if (deQueue_spsc(q, &value) == 0) {
+                    sink += value;
+                    got++;
+                }
+                else
+                    bench_yield();
+            }
+            else {
+                if ((c = deQueue_spsc_n(q, buf, 256)) == 0)
+                    bench_yield();
+                sink += c > 0 ? buf[0] : 0;
+                got += c;
+            }
+        }
+        bench_thread_join(thread);
+
+        if (i < 2)
+            sprintf(name, "spsc 1P/1C, batch %d", batches[i]);
+        else
+            sprintf(name, "spsc 1P/1C, _n x256");
+        bench_report(name, items, items, bench_now() - t0);
+        destroyQueue_spsc(q);
+    }
+
+    initQueue_spsc(q, 4096, 1);                                                     // Round trip through two rings, one value in flight.
+    initQueue_spsc(back, 4096, 1);
+    b.q = q;
+    b.back = back;
+    b.items = items / 100 > 0 ? items / 100 : 1;
+    t0 = bench_now();
+    bench_thread_start(&thread, bench_spsc_echo, &b);
+    for (i = 0; i < b.items; i++) {
+        while (enQueue_spsc(q, i) != 0)
+            bench_backoff(&spin);
+        while (deQueue_spsc(back, &value) != 0)
+            bench_backoff(&spin);
+        sink += value;
+    }
+    bench_thread_join(thread);
+    bench_report_latency("spsc ping-pong latency", b.items, bench_now() - t0);
+    destroyQueue_spsc(q);
+    destroyQueue_spsc(back);
+
+    if (sink == 42)                                                                 // Keep the dequeued values alive.
+        fprintf(stdout, " ");
+    free(q);
+    free(back);
+}
+
+// Allocator churn: each thread keeps a window of live Parcel-sized objects and
+// replaces a pseudo-random one per step, through malloc/free or through one Pool.
+#define BENCH_POOL_WINDOW 256
+
+struct BenchPool {
+    Pool* pool;                                                                     // NULL = malloc / free
+    int steps;
+};
+
+BENCH_THREAD(bench_pool_churn) {
+
+    struct BenchPool* b = (struct BenchPool*)arg;
+    void* live[BENCH_POOL_WINDOW];
+    unsigned int x = 2463534242u;
+    int i, k;
+
+    for (i = 0; i < BENCH_POOL_WINDOW; i++)
+        live[i] = b->pool != NULL ? pool_alloc(b->pool) : malloc(sizeof(Parcel));
+
+    for (i = 0; i < b->steps; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        k = (int)(x % BENCH_POOL_WINDOW);
+        if (b->pool != NULL) {
+            pool_free(b->pool, live[k]);
+            live[k] = pool_alloc(b->pool);
+        }
+        else {
+            free(live[k]);
+            live[k] = malloc(sizeof(Parcel));
+        }
+        ((Parcel*)live[k])->priority = i;                                           // Touch it, as a real caller would.
+    }
+
+    for (i = 0; i < BENCH_POOL_WINDOW; i++) {
+        if (b->pool != NULL)
+            pool_free(b->pool, live[i]);
+        else
+            free(live[i]);
+    }
+
+    BENCH_THREAD_RETURN;
+}
+
+static void bench_pool(int* keys, int n, int max_threads) {
+
+    struct BenchPool b;
+    BenchThread threads[64];
+    PQueue parcels;
+    Pool pool;
+    char name[64];
+    double t0;
+    int pooled, t, i;
+
+    if (pool_init(&pool, sizeof(Parcel)) != 0)
+        return;
+
+    pqueue_init_alloc(&parcels, compare_parcel, pool_allocator(&pool));
+    bench_parcels("parcels (pooled, by pointer)", &parcels, keys, n);
+
+    for (t = 1; t <= max_threads && t <= 64; t *= 2) {
+        for (pooled = 0; pooled < 2; pooled++) {
+
+            b.pool = pooled ? &pool : NULL;
+            b.steps = n / t;
+
+            t0 = bench_now();
+            for (i = 0; i < t; i++)
+                bench_thread_start(&threads[i], bench_pool_churn, &b);
+            for (i = 0; i < t; i++)
+                bench_thread_join(threads[i]);
+
+            sprintf(name, "alloc/free %s %dT", pooled ? "pool" : "malloc", t);
+            bench_report(name, b.steps * t, 2LL * b.steps * t, bench_now() - t0);
+        }
+    }
+
+    if (!bench_json)
+        pool_dump(&pool, "Parcel");
+    pool_destroy(&pool);
+}
+
+static void bench_report_hist(const char* name, int site) {                         // Percentiles of one site since the last reset.
+
+    static const char* const sites[LAT_SITES] = { "get_parcel", "put_parcel", "pqueue_insert", "pqueue_extract" };
+    LatencyHist hist;
+
+    latency_snapshot(site, &hist);
+    if (hist.count == 0)
+        return;
+
+    if (!bench_json) {
+        fprintf(stdout, "  %-34s n=%-10llu p50=%llu p99=%llu p99.9=%llu max=%llu ns\n", sites[site], hist.count,
+            latency_percentile(&hist, 0.5), latency_percentile(&hist, 0.99), latency_percentile(&hist, 0.999), hist.max);
+        return;
+    }
+
+    bench_record();
+    fprintf(stdout, "\"group\": \"%s\", \"name\": \"%s\", \"n\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu }",
+        name, sites[site], hist.count, latency_percentile(&hist, 0.5), latency_percentile(&hist, 0.99),
+        latency_percentile(&hist, 0.999), hist.max);
+}
+
+// Latency histograms: the put / get throughput with timing off and on shows what the
+// two clock reads cost, then a hold run is cut into intervals, each reported and reset
+// the way a monitoring thread would sample a live queue.
+static void bench_latency(int* keys, int n, int intervals) {
+
+    PQueue parcels;
+    Parcel parcel;
+    char name[64];
+    int k, i, site;
+
+    parcels_init(&parcels);
+    bench_parcels("parcels (inline, timing off)", &parcels, keys, n);
+
+    latency_enable(1);
+    latency_reset(-1);
+
+    parcels_init(&parcels);
+    bench_parcels("parcels (inline, timing on)", &parcels, keys, n);
+
+    parcels_init(&parcels);
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        put_parcel(&parcels, &parcel);
+    }
+
+    latency_reset(-1);
+    for (k = 0; k < intervals; k++) {
+        for (i = k * (n / intervals); i < (k + 1) * (n / intervals); i++) {
+            get_parcel(&parcels, &parcel);
+            parcel.priority = keys[(i * 7) % n];
+            put_parcel(&parcels, &parcel);
+        }
+
+        sprintf(name, "latency hold, interval %d", k + 1);
+        bench_section(name);
+        for (site = 0; site < LAT_SITES; site++)
+            bench_report_hist(name, site);
+        latency_reset(-1);
+    }
+
+    pqueue_destroy(&parcels);
+    latency_enable(0);
+}
+
+// keys[from .. to-1] as a put / get hold (a get after every 4th put) on the log and on
+// ref, the same queue without one, skipping either if NULL.
+static void bench_wal_ops(ParcelWal* wal, PQueue* ref, const int* keys, int from, int to) {
+
+    Parcel parcel;
+    int i;
+
+    for (i = from; i < to; i++) {
+        parcel.priority = keys[i];
+        if (wal != NULL)
+            wal_put_parcel(wal, &parcel);
+        if (ref != NULL)
+            put_parcel(ref, &parcel);
+        if (i % 4 == 3) {
+            if (wal != NULL)
+                wal_get_parcel(wal, &parcel);
+            if (ref != NULL)
+                get_parcel(ref, &parcel);
+        }
+    }
+}
+
+// Cut the last bytes bytes off path, as a crash in the middle of a commit would.
+static int bench_wal_cut(const char* path, long bytes) {
+
+    FILE* f;
+    char* data;
+    long size;
+    int status = 0;
+
+    if ((f = fopen(path, "rb")) == NULL)
+        return -1;
+    if (fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < bytes || fseek(f, 0, SEEK_SET) != 0
+        || (data = (char*)malloc((size_t)size + 1)) == NULL) {
+        fclose(f);
+        return -1;
+    }
+    if (fread(data, 1, (size_t)size, f) != (size_t)size)
+        status = -1;
+    fclose(f);
+    f = NULL;
+
+    if (status == 0 && ((f = fopen(path, "wb")) == NULL || fwrite(data, 1, (size_t)(size - bytes), f) != (size_t)(size - bytes)))
+        status = -1;
+    if (f != NULL && fclose(f) != 0)
+        status = -1;
+    free(data);
+
+    return status;
+}
+
+// Close the log, cut the last cut bytes off it and reopen it; the recovered queue must
+// be ref, slot for slot.
+static int bench_wal_reopen(ParcelWal* wal, PQueue* parcels, const char* base, PQueue* ref, long cut) {
+
+    char path[64];
+
+    if (parcels_wal_close(wal) != 0)
+        return -1;
+    pqueue_destroy(parcels);
+
+    sprintf(path, "%s.wal", base);
+    if (cut > 0 && bench_wal_cut(path, cut) != 0)
+        return -1;
+
+    parcels_init_stable(parcels);
+    if (parcels_wal_open(wal, parcels, base, 1000000) != 0)
+        return -1;
+
+    return pqueue_size(parcels) == pqueue_size(ref) && parcels->seq == ref->seq
+        && (pqueue_size(ref) == 0 || memcmp(parcels->tree, ref->tree, (size_t)pqueue_size(ref) * ref->esize) == 0) ? 0 : -1;
+}
+
+// Recovery, checked against a queue that never went through the log: reopen after
+// plain commits, after a checkpoint with records on top of it, and after the last
+// commit was torn off. Returns -1 at the first recovered queue that differs.
+static int bench_wal_recovery(const int* keys, int n) {
+
+    static const char* const base = "bench-wal-check";
+    ParcelWal wal;
+    PQueue parcels, ref;
+    int torn = n / 4 < 1000 ? n / 4 : 1000;                                         // Few enough records for one frame.
+    int status = -1;
+
+    remove("bench-wal-check.wal");
+    remove("bench-wal-check.snap");
+
+    parcels_init_stable(&parcels);
+    parcels_init_stable(&ref);
+    if (parcels_wal_open(&wal, &parcels, base, 1000000) != 0) {
+        pqueue_destroy(&parcels);
+        pqueue_destroy(&ref);
+        return -1;
+    }
+
+    bench_wal_ops(&wal, &ref, keys, 0, n / 4);                                      // Past one buffer: several frames.
+    if (bench_wal_reopen(&wal, &parcels, base, &ref, 0) != 0)
+        goto done;
+
+    if (parcels_wal_checkpoint(&wal) != 0)
+        goto done;
+    bench_wal_ops(&wal, &ref, keys, n / 4, n / 2);
+    if (bench_wal_reopen(&wal, &parcels, base, &ref, 0) != 0 || wal.replayed == 0)
+        goto done;
+
+    bench_wal_ops(&wal, &ref, keys, n / 2, 3 * n / 4);
+    if (parcels_wal_sync(&wal) != 0)
+        goto done;
+    bench_wal_ops(&wal, NULL, keys, 3 * n / 4, 3 * n / 4 + torn);                   // The commit that is torn: not in ref.
+    if (bench_wal_reopen(&wal, &parcels, base, &ref, 1) != 0 || pqueue_size(&parcels) == 0)
+        goto done;
+
+    status = 0;
+
+done:
+    parcels_wal_close(&wal);
+    pqueue_destroy(&parcels);
+    pqueue_destroy(&ref);
+
+    remove("bench-wal-check.wal");
+    remove("bench-wal-check.snap");
+
+    return status;
+}
+
+// Durable parcels: a put / get hold through the write-ahead log per latency budget,
+// against the same run without a log. Budget 0 (an fsync per call) runs fewer ops.
+static void bench_wal(int* keys, int n) {
+
+    static const int budgets[] = { 0, 100, 1000, 10000 };
+    static const char* const base = "bench-wal";
+    ParcelWal wal;
+    PQueue parcels;
+    Parcel parcel;
+    char name[64];
+    double t0;
+    int ops, b, i;
+
+    if (bench_wal_recovery(keys, n) != 0) {
+        fprintf(stderr, "wal: recovered queue differs from the logged one\n");
+        return;
+    }
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        put_parcel(&parcels, &parcel);
+        if (i % 4 == 3)
+            get_parcel(&parcels, &parcel);
+    }
+    bench_report("wal: none (put, get every 4th)", n, n + n / 4, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    for (b = 0; b < (int)(sizeof(budgets) / sizeof(budgets[0])); b++) {
+
+        remove("bench-wal.wal");
+        remove("bench-wal.snap");
+
+        parcels_init(&parcels);
+        if (parcels_wal_open(&wal, &parcels, base, budgets[b]) != 0) {
+            pqueue_destroy(&parcels);
+            return;
+        }
+
+        ops = budgets[b] == 0 && n > 10000 ? 10000 : n;
+        t0 = bench_now();
+        for (i = 0; i < ops; i++) {
+            parcel.priority = keys[i];
+            wal_put_parcel(&wal, &parcel);
+            if (i % 4 == 3)
+                wal_get_parcel(&wal, &parcel);
+        }
+        parcels_wal_sync(&wal);
+
+        sprintf(name, "wal: budget %dus", budgets[b]);
+        bench_report(name, ops, ops + ops / 4, bench_now() - t0);
+        if (!bench_json)
+            fprintf(stdout, "    commits=%lld records/commit=%.0f\n", wal.commits,
+                wal.commits > 0 ? (double)wal.records / wal.commits : 0.0);
+
+        parcels_wal_close(&wal);
+        pqueue_destroy(&parcels);
+    }
+
+    remove("bench-wal.wal");
+    remove("bench-wal.snap");
+}
+
+typedef struct BenchTimer_ {
+
+    long long key;                                                                  // -due: the earliest timer is the root
+    Parcel parcel;
+
+} BenchTimer;
+
+// Timers into a parcels queue: schedule n timers due within span ticks, cancel every
+// other one, then advance a tick at a time until all have fired - once through the
+// timing wheel, once through a keyed heap of (-due, parcel) with handles for cancel.
+static void bench_wheel(int* keys, int n, int span) {
+
+    TimingWheel* wheel;
+    PQueue out;
+    Heap timers;
+    BenchTimer timer;
+    Parcel parcel;
+    int* ids;
+    char name[64];
+    unsigned long long now;
+    double t0, t1, t2;
+    int i;
+
+    if ((wheel = (TimingWheel*)malloc(sizeof(TimingWheel))) == NULL)                // 1024 slot rings: too big for the stack.
+        return;
+    if ((ids = (int*)malloc(n * sizeof(int))) == NULL) {
+        free(wheel);
+        return;
+    }
+
+    parcels_init(&out);
+    wheel_init(wheel, &out, 0);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = keys[i];
+        wheel_schedule(wheel, &parcel, 1 + (unsigned int)keys[i] % span, &ids[i]);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i += 2)
+        wheel_cancel(wheel, ids[i], NULL);
+    t2 = bench_now();
+    for (now = 0; wheel_size(wheel) > 0; now++)
+        wheel_advance(wheel, now);
+
+    sprintf(name, "timers within %d ticks", span);
+    bench_section(name);
+    bench_report("  wheel_schedule", n, n, t1 - t0);
+    bench_report("  wheel_cancel", n, n / 2, t2 - t1);
+    bench_report("  wheel_advance (per timer fired)", n, n - n / 2, bench_now() - t2);
+    if (!bench_json)
+        fprintf(stdout, "    ticks=%llu cascaded=%lld\n", now, wheel->cascaded);
+    wheel_destroy(wheel);
+    pqueue_destroy(&out);
+
+    parcels_init(&out);
+    heap_init_keyed(&timers, sizeof(BenchTimer), HEAP_KEY_I64);
+    heap_enable_handles(&timers);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        timer.key = -(long long)(1 + (unsigned int)keys[i] % span);
+        timer.parcel.priority = keys[i];
+        heap_insert_handle(&timers, &timer, &ids[i]);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i += 2)
+        heap_remove(&timers, ids[i], (void**)&timer);
+    t2 = bench_now();
+    for (now = 0; heap_size(&timers) > 0; now++)
+        while (heap_size(&timers) > 0 && -((BenchTimer*)heap_elem(&timers, 0))->key <= (long long)now) {
+            heap_extract(&timers, (void**)&timer);
+            put_parcel(&out, &timer.parcel);
+        }
+
+    bench_report("  heap schedule", n, n, t1 - t0);
+    bench_report("  heap cancel", n, n / 2, t2 - t1);
+    bench_report("  heap expire (per timer fired)", n, n - n / 2, bench_now() - t2);
+    heap_destroy(&timers);
+    pqueue_destroy(&out);
+
+    free(ids);
+    free(wheel);
+}
+
+// The k highest of n streamed parcels: a bounded heap kept with heap_insert + heap_extract
+// (two sifts per admitted item), with the fused heap_pushpop, through topk_put_parcel,
+// and by loading everything into a parcels queue and taking the first k.
+static void bench_topk(int* keys, int n, int k) {
+
+    ParcelTopK topk;
+    PQueue parcels;
+    Heap best;
+    Parcel* items;
+    Parcel* out;
+    Parcel parcel;
+    char name[64];
+    double t0;
+    int i;
+
+    if ((items = (Parcel*)malloc(n * sizeof(Parcel))) == NULL)
+        return;
+    if ((out = (Parcel*)malloc(n * sizeof(Parcel))) == NULL) {
+        free(items);
+        return;
+    }
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    sprintf(name, "top %d of a stream", k);
+    bench_section(name);
+
+    heap_init_keyed(&best, sizeof(Parcel), HEAP_KEY_I32);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = ~items[i].priority;                                       // Lowest priority at the root.
+        heap_insert(&best, &parcel);
+        if (heap_size(&best) > k)
+            heap_extract(&best, (void**)&parcel);
+    }
+    bench_report("  heap_insert + heap_extract", n, n, bench_now() - t0);
+    heap_destroy(&best);
+
+    heap_init_keyed(&best, sizeof(Parcel), HEAP_KEY_I32);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        parcel.priority = ~items[i].priority;
+        if (heap_size(&best) < k)
+            heap_insert(&best, &parcel);
+        else
+            heap_pushpop(&best, &parcel, (void**)&parcel);
+    }
+    bench_report("  heap_pushpop", n, n, bench_now() - t0);
+    heap_destroy(&best);
+
+    parcels_topk_init(&topk, k);
+    t0 = bench_now();
+    for (i = 0; i < n; i++)
+        topk_put_parcel(&topk, &items[i]);
+    if (!bench_json)
+        fprintf(stdout, "    rejected at the root: %.1f%%\n", 100.0 * topk.rejected / n);
+    topk_get_parcels(&topk, out, k);
+    bench_report("  topk_put_parcel + topk_get_parcels", n, n, bench_now() - t0);
+    parcels_topk_destroy(&topk);
+
+    parcels_init(&parcels);
+    t0 = bench_now();
+    load_parcels(&parcels, items, n);
+    get_parcels(&parcels, out, k);
+    bench_report("  load_parcels + get_parcels", n, n, bench_now() - t0);
+    pqueue_destroy(&parcels);
+
+    free(out);
+    free(items);
+}
+
+// Folding a station's queue of moved parcels into one holding n - moved: get_parcel /
+// put_parcel one at a time against pqueue_merge, for a like-sized and a small src, and
+// with handles on dst (no tree swap: src is always the one appended).
+static void bench_merge(int* keys, int n) {
+
+    static const int divisors[] = { 2, 64 };
+    PQueue dst, src;
+    Parcel* items;
+    Parcel parcel;
+    char name[64];
+    double t0;
+    int moved, d, i;
+
+    if ((items = (Parcel*)malloc(n * sizeof(Parcel))) == NULL)
+        return;
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+
+    for (d = 0; d < 2; d++) {
+
+        moved = n / divisors[d];
+        sprintf(name, "merge %d parcels into %d", moved, n - moved);
+        bench_section(name);
+
+        parcels_init(&dst);
+        parcels_init(&src);
+        load_parcels(&dst, items, n - moved);
+        load_parcels(&src, items + n - moved, moved);
+        t0 = bench_now();
+        while (get_parcel(&src, &parcel) == 0)
+            put_parcel(&dst, &parcel);
+        bench_report("  get_parcel + put_parcel", moved, moved, bench_now() - t0);
+        pqueue_destroy(&dst);
+        pqueue_destroy(&src);
+
+        parcels_init(&dst);
+        parcels_init(&src);
+        load_parcels(&dst, items, n - moved);
+        load_parcels(&src, items + n - moved, moved);
+        t0 = bench_now();
+        pqueue_merge(&dst, &src);
+        bench_report("  pqueue_merge", moved, moved, bench_now() - t0);
+        pqueue_destroy(&dst);
+        pqueue_destroy(&src);
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+        parcels_init(&dst);
+        parcels_init(&src);
+        load_parcels(&dst, items, n - moved);
+        load_parcels(&src, items + n - moved, moved);
+        pqueue_enable_handles(&dst);
+        t0 = bench_now();
+        pqueue_merge(&dst, &src);
+        bench_report("  pqueue_merge, handles on dst", moved, moved, bench_now() - t0);
+        pqueue_destroy(&dst);
+        pqueue_destroy(&src);
+#endif
+    }
+
+    parcels_init(&dst);                                                             // The small queue merged into the large one:
+    parcels_init(&src);                                                             // trees are swapped, not copied.
+    load_parcels(&dst, items, n / 64);
+    load_parcels(&src, items + n / 64, n - n / 64);
+    t0 = bench_now();
+    pqueue_merge(&dst, &src);
+    bench_report("merge large src into small dst", n - n / 64, n - n / 64, bench_now() - t0);
+    pqueue_destroy(&dst);
+    pqueue_destroy(&src);
+
+    free(items);
+}
+
+static int compare_parcel_desc(const void* parcel1, const void* parcel2) {        // Highest priority first, as queues and merges emit.
+
+    return compare_parcel(parcel2, parcel1);
+}
+
+// Merging k sorted runs of n parcels in total, 1024 at a time into an output buffer:
+// through a loser tree, and through a binary and a 4-ary heap of the k stream heads
+// (one heap_replace per element, the fused form), keyed like the tree's nodes.
+static void bench_kmerge(int* keys, int n, int k) {
+
+    static const int arities[] = { 2, 4 };
+    LoserTree tree;
+    LoserInput* inputs;
+    Parcel* items;
+    Parcel* out;
+    Heap heads;
+    long long key;
+    int* next;
+    char name[64];
+    double t0;
+    int count, a, i, r;
+
+    items = (Parcel*)malloc(n * sizeof(Parcel));
+    out = (Parcel*)malloc(1024 * sizeof(Parcel));
+    inputs = (LoserInput*)malloc(k * sizeof(LoserInput));
+    next = (int*)malloc((k + 1) * sizeof(int));
+    if (items == NULL || out == NULL || inputs == NULL || next == NULL) {
+        free(items);
+        free(out);
+        free(inputs);
+        free(next);
+        return;
+    }
+
+    for (r = 0; r <= k; r++)                                                        // Run r is items[next[r] .. next[r + 1]).
+        next[r] = (int)((long long)n * r / k);
+    for (i = 0; i < n; i++)
+        items[i].priority = keys[i];
+    for (r = 0; r < k; r++)
+        qsort(&items[next[r]], next[r + 1] - next[r], sizeof(Parcel), compare_parcel_desc);
+
+    sprintf(name, "merge %d sorted runs", k);
+    bench_section(name);
+
+    for (r = 0; r < k; r++)
+        loser_input(&inputs[r], &items[next[r]], next[r + 1] - next[r], NULL, NULL);
+    t0 = bench_now();
+    loser_init(&tree, inputs, k);
+    while ((count = loser_merge(&tree, out, 1024)) > 0)
+        ;
+    bench_report("  loser_merge", n, n, bench_now() - t0);
+    loser_destroy(&tree);
+
+    for (a = 0; a < 2; a++) {
+
+        heap_init_keyed(&heads, sizeof(long long), HEAP_KEY_I64);
+        heap_set_arity(&heads, arities[a]);
+        for (r = 0; r < k; r++)
+            inputs[r].next = 0;
+        t0 = bench_now();
+        for (r = 0; r < k; r++) {
+            if (inputs[r].size > 0) {
+                key = heap_stable_key(inputs[r].items[0].priority, r);
+                heap_insert(&heads, &key);
+            }
+        }
+        count = 0;
+        while (heap_size(&heads) > 0) {
+
+            r = (int)heap_stable_seq(*(long long*)heap_elem(&heads, 0));
+            memcpy(&out[count++], &inputs[r].items[inputs[r].next++], sizeof(Parcel));
+            if (count == 1024)
+                count = 0;
+
+            if (inputs[r].next < inputs[r].size) {
+                key = heap_stable_key(inputs[r].items[inputs[r].next].priority, r);
+                heap_replace(&heads, &key, (void**)&key);
+            }
+            else
+                heap_extract(&heads, (void**)&key);
+        }
+        sprintf(name, "  %d-ary heap of stream heads", arities[a]);
+        bench_report(name, n, n, bench_now() - t0);
+        heap_destroy(&heads);
+    }
+
+    free(next);
+    free(inputs);
+    free(out);
+    free(items);
+}
+
+// Hot-path counters (HEAP_STATS builds) for a hold run per arity and for a cqueue burst
+// workload: average sift depth and compares per operation show the heap's shape,
+// reallocs and ring allocs the allocator's share.
+static void bench_stats(int* keys, int n) {
+
+    static const int arities[] = { 2, 4, 8 };
+    struct Queue q;
+    PQueue pqueue;
+    char name[64];
+    int out[8];
+    int value;
+    int a, i;
+
+    for (a = 0; a < 3; a++) {
+
+        pqueue_init_keyed(&pqueue, sizeof(int), HEAP_KEY_I32);
+        heap_set_arity(&pqueue, arities[a]);
+        for (i = 0; i < n; i++)
+            pqueue_insert(&pqueue, &keys[i]);
+        for (i = 0; i < n; i++) {
+            pqueue_extract(&pqueue, (void**)&value);
+            pqueue_insert(&pqueue, &keys[(i * 7) % n]);
+        }
+
+        sprintf(name, "hold %d-ary", arities[a]);
+        pqueue_stats_dump(&pqueue, name);
+        pqueue_destroy(&pqueue);
+    }
+
+    initQueue(&q);
+    for (i = 0; i < n; i++) {
+        enQueue(&q, keys[i]);
+        if (i % 16 == 15)
+            deQueue_n(&q, out, 8);                                                  // Net growth of 8 per burst of 16.
+    }
+    dumpStatsQueue(&q, "bursts");
+    destroyQueue(&q);
+}
+
+// Benchmark suite: every target through the same phases (see BenchTimes), per key
+// distribution and size. Small sizes repeat the fill / drain until each phase has
+// run about a million operations, so every row is long enough to time.
+#define BENCH_SUITE_OPS 1000000
+
+static const char* const bench_dists[] = { "random", "sorted", "reverse", "duplicates" };
+
+static void bench_suite_keys(int* keys, int n, int dist) {
+
+    int i;
+
+    bench_seed = 2463534242u;
+    for (i = 0; i < n; i++)
+        keys[i] = dist == 0 ? bench_rand()
+            : dist == 1 ? i                                                         // Ascending: every insert sifts to the root.
+            : dist == 2 ? n - i
+            : bench_rand() & 15;                                                    // 16 distinct keys.
+}
+
+static void bench_init_heap(PQueue* q) { heap_init_sized(q, sizeof(int), compare_int); }
+
+static void bench_init_pqueue(PQueue* q) { pqueue_init_keyed(q, sizeof(int), HEAP_KEY_I32); }
+
+static void bench_init_parcels(PQueue* q) { parcels_init(q); }
+
+static void bench_init_stable(PQueue* q) { parcels_init_stable(q); }
+
+static void bench_suite_put(PQueue* q, int parcels, const int* key) {
+
+    Parcel parcel;
+
+    parcel.priority = *key;
+    if (parcels)
+        put_parcel(q, &parcel);
+    else
+        pqueue_insert(q, key);
+}
+
+static void bench_suite_get(PQueue* q, int parcels) {
+
+    Parcel parcel;
+    int value;
+
+    if (parcels)
+        get_parcel(q, &parcel);
+    else
+        pqueue_extract(q, (void**)&value);
+}
+
+// One priority queue target: heap_insert / heap_extract, or put_parcel / get_parcel.
+static void bench_suite_queue(void (*init)(PQueue* q), int parcels, const int* keys, int n,
+    int reps, int rounds, BenchTimes* times) {
+
+    PQueue q;
+    volatile unsigned int sink = 0;
+    double t0;
+    int r, i;
+
+    times->insert = times->peek = times->extract = times->hold = 0;
+
+    for (r = 0; r < reps; r++) {
+
+        init(&q);
+
+        t0 = bench_now();
+        for (i = 0; i < n; i++)
+            bench_suite_put(&q, parcels, &keys[i]);
+        times->insert += bench_now() - t0;
+
+        t0 = bench_now();
+        for (i = 0; i < n; i++)
+            sink = sink + *(const char*)pqueue_peek(&q);
+        times->peek += bench_now() - t0;
+
+        t0 = bench_now();
+        for (i = 0; i < n; i++)
+            bench_suite_get(&q, parcels);
+        times->extract += bench_now() - t0;
+
+        pqueue_destroy(&q);
+    }
+
+    init(&q);
+    for (i = 0; i < n; i++)                                                         // Hold at steady size n.
+        bench_suite_put(&q, parcels, &keys[i]);
+
+    t0 = bench_now();
+    for (i = 0; i < rounds; i++) {
+        bench_suite_get(&q, parcels);
+        bench_suite_put(&q, parcels, &keys[i % n]);
+    }
+    times->hold = bench_now() - t0;
+
+    pqueue_destroy(&q);
+}
+
+static void bench_suite_cqueue(const int* keys, int n, int reps, int rounds, BenchTimes* times) {
+
+    struct Queue q;
+    volatile unsigned int sink = 0;
+    double t0;
+    int r, i;
+
+    times->insert = times->extract = times->hold = 0;
+    times->peek = -1;                                                               // No peek in the cqueue API.
+
+    for (r = 0; r < reps; r++) {
+
+        initQueue(&q);
+
+        t0 = bench_now();
+        for (i = 0; i < n; i++)
+            enQueue(&q, keys[i]);
+        times->insert += bench_now() - t0;
+
+        t0 = bench_now();
+        for (i = 0; i < n; i++)
+            sink = sink + deQueue(&q);
+        times->extract += bench_now() - t0;
+
+        destroyQueue(&q);
+    }
+
+    initQueue(&q);
+    for (i = 0; i < n; i++)
+        enQueue(&q, keys[i]);
+
+    t0 = bench_now();
+    for (i = 0; i < rounds; i++) {
+        sink = sink + deQueue(&q);
+        enQueue(&q, keys[i % n]);
+    }
+    times->hold = bench_now() - t0;
+
+    destroyQueue(&q);
+}
+
+static void bench_suite_report(const char* target, const char* dist, const char* op, int n, long long ops, double secs) {
+
+    char name[96];
+
+    if (secs < 0)                                                                   // Phase not supported by the target.
+        return;
+
+    if (!bench_json) {
+        sprintf(name, "%s %s %s", target, dist, op);
+        bench_report(name, n, ops, secs);
+        return;
+    }
+
+    bench_record();
+    fprintf(stdout, "\"group\": \"suite\", \"target\": \"%s\", \"dist\": \"%s\", \"name\": \"%s\", "
+        "\"n\": %d, \"ops\": %lld, \"secs\": %.6f, \"ops_per_sec\": %.0f }",
+        target, dist, op, n, ops, secs, secs > 0 ? ops / secs : 0.0);
+}
+
+static void bench_suite(int max_n) {
+
+    static const char* const targets[] = { "heap", "pqueue", "std::priority_queue", "parcels", "parcels stable", "cqueue" };
+    static void (* const inits[])(PQueue* q) = { bench_init_heap, bench_init_pqueue, NULL, bench_init_parcels, bench_init_stable, NULL };
+    BenchTimes times;
+    int* keys;
+    int dist, t, n, reps;
+
+    if ((keys = (int*)malloc((size_t)max_n * sizeof(int))) == NULL)
+        return;
+
+    for (dist = 0; dist < 4; dist++) {
+        for (n = 10; n <= max_n; n = n > max_n / 10 ? max_n + 1 : n * 10) {
+
+            bench_suite_keys(keys, n, dist);
+            reps = n < BENCH_SUITE_OPS ? BENCH_SUITE_OPS / n : 1;
+
+            for (t = 0; t < 6; t++) {
+
+                if (t == 2)
+                    bench_std_run(keys, n, reps, BENCH_SUITE_OPS, &times);
+                else if (t == 5)
+                    bench_suite_cqueue(keys, n, reps, BENCH_SUITE_OPS, &times);
+                else
+                    bench_suite_queue(inits[t], t >= 3, keys, n, reps, BENCH_SUITE_OPS, &times);
+
+                bench_suite_report(targets[t], bench_dists[dist], "insert", n, (long long)reps * n, times.insert);
+                bench_suite_report(targets[t], bench_dists[dist], "peek", n, (long long)reps * n, times.peek);
+                bench_suite_report(targets[t], bench_dists[dist], "extract", n, (long long)reps * n, times.extract);
+                bench_suite_report(targets[t], bench_dists[dist], "hold", n, 2LL * BENCH_SUITE_OPS, times.hold);
+            }
+        }
+    }
+
+    free(keys);
+}
+
+int main(int argc, char* argv[])
+{
+    int n = 1000000;
+    int suite = 0;
+    int* keys;
+    PQueue parcels;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0)
+            bench_json = 1;
+        else if (strcmp(argv[i], "--suite") == 0)
+            suite = 1;
+        else
+            n = atoi(argv[i]);
+    }
+
+    if (n <= 0)
+        return 1;
+
+    if (suite) {
+        bench_suite(n);
+        if (bench_json)
+            fprintf(stdout, "%s\n", bench_records == 0 ? "[]" : "\n]");
+        return 0;
+    }
+
+    if ((keys = (int*)malloc(n * sizeof(int))) == NULL)
+        return 1;
+
+    for (i = 0; i < n; i++)
+        keys[i] = bench_rand();
+
+    bench_heap_fill_drain("heap (legacy realloc per op)", keys, n, legacy_insert, legacy_extract, legacy_destroy);
+    bench_heap_fill_drain("heap (amortized capacity)", keys, n, heap_insert, heap_extract, heap_destroy);
+
+    bench_heap_hold("hold (legacy realloc per op)", keys, n, n, legacy_insert, legacy_extract, legacy_destroy);
+    bench_heap_hold("hold (amortized capacity)", keys, n, n, heap_insert, heap_extract, heap_destroy);
+
+    pqueue_init(&parcels, compare_parcel, free);
+    bench_parcels("parcels (malloc'd, by pointer)", &parcels, keys, n);
+    parcels_init(&parcels);
+    bench_parcels("parcels (inline, by value)", &parcels, keys, n);
+    parcels_init_stable(&parcels);
+    bench_parcels("parcels (stable FIFO, packed key)", &parcels, keys, n);
+    for (i = 0; i < n; i++)                                                         // Many ties: the case stability is for.
+        keys[i] &= 255;
+    parcels_init(&parcels);
+    bench_parcels("parcels (inline, 256 priorities)", &parcels, keys, n);
+    parcels_init_stable(&parcels);
+    bench_parcels("parcels (stable FIFO, 256 priorities)", &parcels, keys, n);
+    bench_seed = 2463534242u;
+    for (i = 0; i < n; i++)
+        keys[i] = bench_rand();
+
+    bench_parcel_heap("parcels (ParcelHeap, inlined compare)", keys, n);
+
+    bench_sized_fill_drain("int heap (compare via pointer)", keys, n);
+    bench_intheap_fill_drain("int heap (IntHeap, inlined compare)", keys, n);
+
+    bench_arity_sweep(keys, n);
+
+    bench_simd_select(keys, n);
+
+    bench_cold_start(keys, n);
+
+    bench_batch_dispatch(keys, n, 64);
+
+    bench_reprioritize(keys, n, n);
+
+    bench_radix(keys, n);
+
+    bench_bucket(keys, n);
+
+    bench_extheap(keys, n);
+
+    bench_cqueue(keys, n, 10000000, 16);
+    bench_cqueue(keys, n, 10000000, 4096);
+
+    bench_mpmc(n, 8);
+
+    bench_spsc(10 * n);
+
+    bench_pool(keys, n, 8);
+
+    bench_latency(keys, n, 4);
+
+    bench_wal(keys, n);
+
+    bench_wheel(keys, n, 1 << 10);
+    bench_wheel(keys, n, 1 << 20);
+
+    bench_topk(keys, n, 100);
+    bench_topk(keys, n, 10000);
+
+    bench_merge(keys, n);
+
+    bench_kmerge(keys, n, 8);
+    bench_kmerge(keys, n, 64);
+    bench_kmerge(keys, n, 512);
+
+    bench_suite(n);
+
+    if (!bench_json)
+        bench_stats(keys, n);
+
+    if (bench_json)
+        fprintf(stdout, "%s\n", bench_records == 0 ? "[]" : "\n]");
+
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,53 @@
+// bench_std.cpp : std::priority_queue baseline for the benchmark suite in bench.c
+///////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <queue>
+#include <vector>
+
+#include "bench_std.h"
+
+static double bench_std_now() {                                                   // Same clock as bench_now, in seconds.
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" void bench_std_run(const int* keys, int n, int reps, int rounds, BenchTimes* times) {
+
+    std::priority_queue<int> pq;
+    volatile unsigned int sink = 0;
+    double t0;
+    int r, i;
+
+    times->insert = times->peek = times->extract = times->hold = 0;
+
+    for (r = 0; r < reps; r++) {
+
+        pq = std::priority_queue<int>();                                            // Start every rep empty, as the C targets do.
+
+        t0 = bench_std_now();
+        for (i = 0; i < n; i++)
+            pq.push(keys[i]);
+        times->insert += bench_std_now() - t0;
+
+        t0 = bench_std_now();
+        for (i = 0; i < n; i++)
+            sink = sink + pq.top();
+        times->peek += bench_std_now() - t0;
+
+        t0 = bench_std_now();
+        for (i = 0; i < n; i++)
+            pq.pop();
+        times->extract += bench_std_now() - t0;
+    }
+
+    for (i = 0; i < n; i++)
+        pq.push(keys[i]);
+
+    t0 = bench_std_now();
+    for (i = 0; i < rounds; i++) {
+        pq.pop();
+        pq.push(keys[i % n]);
+    }
+    times->hold = bench_std_now() - t0;
+}
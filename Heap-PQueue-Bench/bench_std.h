@@ -0,0 +1,29 @@
+// bench_std.h - std::priority_queue baseline for the benchmark suite
+////////////////////////////////////////////////////////////////////
+#ifndef BENCH_STD_H
+#define BENCH_STD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Seconds per phase of one suite run; a phase a target does not support stays < 0.
+typedef struct BenchTimes_ {
+
+	double insert;                                             // reps x n inserts into an empty queue
+	double peek;                                               // reps x n peeks at the full queue
+	double extract;                                            // reps x n extracts down to empty
+	double hold;                                               // rounds x (extract + insert) at steady size n
+
+} BenchTimes;
+
+// std::priority_queue<int> (max-heap over std::vector) through the same phases as the
+// C targets in bench.c: keys[0 .. n-1] are inserted, the hold phase reinserts keys
+// cyclically.
+void bench_std_run(const int* keys, int n, int reps, int rounds, BenchTimes* times);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,12 +1,25 @@
 // Heap-PQueue.c : This file contains the 'main' function. Program execution begins and ends there.
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "heap.h"
 
 #include "heap.h"
+#include "heapsimd.h"
+#include "latency.h"
 #include "pqueue.h"
 #include "cqueue.h"
 
@@ -22,382 +35,2262 @@
 // typedef struct Heap_ {
 //
 //     int size;
+//     int capacity;
+//     int esize;
+//     int dshift;
+//     int keytype;
 //
 //     int (*compare)(const void* key1, const void* key2);
 //     void (*destroy)(void* data);
+//     const HeapAllocator* alloc;
+//     int (*select)(const void* keys);
 //
 //     void** tree;
 //
+//     int* ids;
+//     int* pos;
+//     int nhandles;
+//     int freeh;
+//
+//     unsigned int seq;
+//
+//     void* map;
+//     size_t map_bytes;
+//
+// #if HEAP_STATS
+//     HeapStats stats;
+//     long long sift_mark;
+// #endif
+//
 // } Heap;
+//
+// tree is an array of fixed-width slots. With esize == 0 (heap_init) each slot
+// holds a caller-owned pointer; with esize > 0 (heap_init_sized) each slot holds
+// the element itself, copied in by heap_insert and out by heap_extract.
+//
+// The tree is d-ary with d = 1 << dshift (binary by default, heap_set_arity for
+// 4/8/16). The children of node i are slots d*i+1 .. d*i+d. tree is allocated so
+// that slot 1 starts a cache line; with d * width <= HEAP_CACHE_LINE every sibling
+// group then sits inside one line and picking the best child costs one miss.
+//
+// Keyed heaps (heap_init_keyed) compare their int32/int64 keys inline through
+// heap_cmp, and select, when set, reduces a whole sibling group in SIMD registers.
+//
+// tree has one spare slot past capacity: the scratch slot, where heap_build and
+// heap_update park the node they are sifting.
+//
+// With handles enabled (heap_enable_handles) ids[npos] is the handle of the node in
+// slot npos and pos[handle] its slot, so every move keeps both in step. Free handles
+// form a list through pos: pos[h] = -2 - next, ending at freeh = -1.
+//
+// After heap_load, tree points into map, a private copy-on-write mapping of the
+// snapshot file laid out like a heap_resize block; heap_tree_free unmaps it.
 ///////////////////////////////////////////////////////////
 
-////////////////////////////////////////////////////////////
-//  Define private macros used by the heap implementation. 
-////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////
+//  Define private macros used by the heap implementation. 
+////////////////////////////////////////////////////////////
+
+#define heap_parent(heap, npos) ((int)(((npos) - 1) >> (heap)->dshift))
+
+#define heap_child(heap, npos) (((npos) << (heap)->dshift) + 1)
+
+#define heap_arity(heap) (1 << (heap)->dshift)
+
+#define heap_width(heap) ((heap)->esize == 0 ? (int)sizeof(void*) : (heap)->esize)
+
+#define heap_pad(heap) ((HEAP_CACHE_LINE - heap_width(heap) % HEAP_CACHE_LINE) % HEAP_CACHE_LINE)
+
+#define heap_slot(heap, npos) ((char*)(heap)->tree + (size_t)(npos) * heap_width(heap))
+
+#define heap_key_i32(elem) (*(const int*)(elem))
+
+#define heap_key_i64(elem) (*(const long long*)(elem))
+
+#if HEAP_STATS                                                                      // Hot-path counters, compiled out by default.
+#define heap_count(heap, field, n) ((void)((heap)->stats.field += (n)))
+#define heap_count_peak(heap) \
+    ((void)((heap)->stats.peak_size < (heap)->size ? (heap)->stats.peak_size = (heap)->size : 0))
+#define heap_sift_begin(heap) ((void)((heap)->sift_mark = (heap)->stats.sift_levels))
+#define heap_sift_end(heap) ((void)((heap)->stats.sift_levels - (heap)->sift_mark > (heap)->stats.sift_max \
+    ? (heap)->stats.sift_max = (heap)->stats.sift_levels - (heap)->sift_mark : 0))
+#else
+#define heap_count(heap, field, n) ((void)0)
+#define heap_count_peak(heap) ((void)0)
+#define heap_sift_begin(heap) ((void)0)
+#define heap_sift_end(heap) ((void)0)
+#endif
+
+#define heap_cmp(heap, key1, key2) (heap_count((heap), compares, 1), heap_cmp_raw((heap), (key1), (key2)))
+
+#define heap_cmp_raw(heap, key1, key2) \
+    ((heap)->keytype == HEAP_KEY_I32 ? (heap_key_i32(key1) > heap_key_i32(key2)) - (heap_key_i32(key1) < heap_key_i32(key2)) \
+    : (heap)->keytype == HEAP_KEY_I64 ? (heap_key_i64(key1) > heap_key_i64(key2)) - (heap_key_i64(key1) < heap_key_i64(key2)) \
+    : (heap)->compare((key1), (key2)))
+
+#define heap_scratch(heap) heap_slot(heap, (heap)->capacity)
+
+#define heap_id(heap, npos) ((heap)->ids != NULL ? (heap)->ids[npos] : -1)
+
+#define heap_handle_valid(heap, handle) \
+    ((heap)->ids != NULL && (handle) >= 0 && (handle) < (heap)->nhandles && (heap)->pos[handle] >= 0)
+
+#define heap_item_key(heap, item) ((heap)->esize == 0 ? *(void* const*)(item) : (const void*)(item))
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Public interface: Heap API
+////////////////////////////////
+// void heap_init(Heap* heap, int (*compare)(const void* key1, const void* key2),  void (*destroy)(void* data))
+// void heap_init_alloc(Heap* heap, int (*compare)(const void* key1, const void* key2), const HeapAllocator* alloc)
+// void heap_init_sized(Heap* heap, int esize, int (*compare)(const void* key1, const void* key2))
+// void heap_init_keyed(Heap* heap, int esize, int keytype)
+// int  heap_set_arity(Heap* heap, int arity)
+// void heap_destroy(Heap* heap)
+// int  heap_insert(Heap* heap, const void* data)
+// int  heap_extract(Heap* heap, void** data)
+// int  heap_build(Heap* heap, void** items, int n)
+// int  heap_insert_many(Heap* heap, void** items, int n)
+// int  heap_extract_k(Heap* heap, void** data, int k)
+// int  heap_merge(Heap* dst, Heap* src)
+// int  heap_merge_remap(Heap* dst, Heap* src, int* remap)
+// int  heap_pushpop(Heap* heap, const void* data, void** out)
+// int  heap_replace(Heap* heap, const void* data, void** out)
+// int  heap_reserve(Heap* heap, int capacity)
+// int  heap_shrink_to_fit(Heap* heap)
+// int  heap_enable_handles(Heap* heap)
+// int  heap_insert_handle(Heap* heap, const void* data, int* handle)
+// int  heap_update(Heap* heap, int handle)
+// int  heap_remove(Heap* heap, int handle, void** data)
+// int  heap_stats(Heap* heap, HeapStats* stats)
+// void heap_stats_reset(Heap* heap)
+// void heap_stats_dump(Heap* heap, const char* name)
+// int  heap_save(Heap* heap, const char* path)
+// int  heap_load(Heap* heap, const char* path)
+// int  heap_dir_sync(const char* path)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+void heap_init(Heap* heap, int (*compare)(const void* key1, const void* key2),  void (*destroy)(void* data)) {
+
+    heap->size = 0;
+    heap->capacity = 0;
+    heap->esize = 0;
+    heap->dshift = 1;
+    heap->keytype = HEAP_KEY_NONE;
+    heap->compare = compare;
+    heap->destroy = destroy;
+    heap->alloc = NULL;
+    heap->select = NULL;
+    heap->tree = NULL;
+    heap->ids = NULL;
+    heap->pos = NULL;
+    heap->nhandles = 0;
+    heap->freeh = -1;
+    heap->seq = 0;
+    heap->map = NULL;
+    heap->map_bytes = 0;
+#if HEAP_STATS
+    memset(&heap->stats, 0, sizeof(HeapStats));
+    heap->sift_mark = 0;
+#endif
+
+    return;
+}
+
+void heap_init_alloc(Heap* heap, int (*compare)(const void* key1, const void* key2), const HeapAllocator* alloc) {
+
+    heap_init(heap, compare, NULL);
+    heap->alloc = alloc;
+
+    return;
+}
+
+void heap_init_sized(Heap* heap, int esize, int (*compare)(const void* key1, const void* key2)) {
+
+    heap_init(heap, compare, NULL);                                                 // Elements live inside tree, nothing to destroy.
+    heap->esize = esize;
+
+    return;
+}
+
+static int compare_key_i32(const void* key1, const void* key2) {                 // Same order as heap_cmp, for callers that only use compare.
+
+    return (heap_key_i32(key1) > heap_key_i32(key2)) - (heap_key_i32(key1) < heap_key_i32(key2));
+}
+
+static int compare_key_i64(const void* key1, const void* key2) {
+
+    return (heap_key_i64(key1) > heap_key_i64(key2)) - (heap_key_i64(key1) < heap_key_i64(key2));
+}
+
+// Pick the SIMD kernel for the current keytype and arity; only packed keys qualify.
+static void heap_select_kernel(Heap* heap) {
+
+    int kwidth = heap->keytype == HEAP_KEY_I32 ? (int)sizeof(int) : (int)sizeof(long long);
+
+    if (heap->keytype == HEAP_KEY_NONE || heap->esize != kwidth)
+        heap->select = NULL;
+    else
+        heap->select = heap_simd_select(heap->keytype, heap_arity(heap));
+}
+
+void heap_init_keyed(Heap* heap, int esize, int keytype) {
+
+    heap_init_sized(heap, esize, keytype == HEAP_KEY_I64 ? compare_key_i64 : compare_key_i32);
+    heap->keytype = keytype;
+    heap_select_kernel(heap);
+
+    return;
+}
+
+int heap_set_arity(Heap* heap, int arity) {
+
+    int dshift;
+
+    if (heap_size(heap) != 0)                                                       // The layout of a populated tree depends on d.
+        return -1;
+
+    for (dshift = 1; dshift <= 4; dshift++) {
+
+        if (arity == 1 << dshift) {
+            heap->dshift = dshift;
+            heap_select_kernel(heap);
+            return 0;
+        }
+    }
+
+    return -1;                                                                      // Only 2, 4, 8 and 16 are supported.
+}
+
+static void heap_unmap(void* map, size_t bytes) {
+
+#ifdef _WIN32
+    (void)bytes;
+    UnmapViewOfFile(map);
+#else
+    munmap(map, bytes);
+#endif
+}
+
+// Free a tree allocated by heap_resize.
+static void heap_tree_free(Heap* heap) {
+
+    if (heap->tree == NULL)
+        return;
+
+    if (heap->map != NULL) {                                                        // Adopted from a snapshot by heap_load.
+        heap_unmap(heap->map, heap->map_bytes);
+        heap->map = NULL;
+        heap->map_bytes = 0;
+        return;
+    }
+
+#ifdef _WIN32
+    _aligned_free((char*)heap->tree - heap_pad(heap));
+#else
+    free((char*)heap->tree - heap_pad(heap));
+#endif
+}
+
+// Resize the tree to exactly capacity slots (plus the scratch slot); the caller
+// guarantees capacity >= size. realloc cannot preserve alignment, so this allocates
+// a fresh cache-line aligned block and copies; geometric growth keeps that O(1)
+// amortized.
+static int heap_resize(Heap* heap, int capacity) {
+
+    size_t bytes = ((size_t)capacity + 1) * heap_width(heap);
+    char* block;
+    int* ids;
+
+    if (capacity == 0) {
+        heap_tree_free(heap);
+        heap->tree = NULL;
+        heap->capacity = 0;
+        return 0;
+    }
+
+#ifdef _WIN32
+    if ((block = (char*)_aligned_malloc(heap_pad(heap) + bytes, HEAP_CACHE_LINE)) == NULL)
+        return -1;
+#else
+    if (posix_memalign((void**)&block, HEAP_CACHE_LINE, heap_pad(heap) + bytes) != 0)
+        return -1;
+#endif
+
+    if (heap->ids != NULL) {                                                        // Slot -> handle map follows the tree's capacity.
+
+        if ((ids = (int*)realloc(heap->ids, ((size_t)capacity + 1) * sizeof(int))) == NULL) {
+#ifdef _WIN32
+            _aligned_free(block);
+#else
+            free(block);
+#endif
+            return -1;
+        }
+        heap->ids = ids;
+    }
+
+    if (heap_size(heap) > 0)
+        memcpy(block + heap_pad(heap), heap->tree, (size_t)heap_size(heap) * heap_width(heap));
+
+    heap_tree_free(heap);
+
+    heap->tree = (void**)(block + heap_pad(heap));                                   // Slot 1, the first sibling group, starts a cache line.
+    heap->capacity = capacity;
+    heap_count(heap, reallocs, 1);
+
+    return 0;
+}
+
+// Make room for count slots, growing geometrically so that any sequence of inserts
+// and batches reallocates O(log n) times in total.
+static int heap_grow(Heap* heap, int count) {
+
+    int capacity;
+
+    if (count <= heap->capacity)
+        return 0;
+
+    if (heap->capacity == 0)
+        capacity = HEAP_MIN_CAPACITY;
+    else
+        capacity = heap->capacity > INT_MAX / 2 ? count : heap->capacity * 2;      // Past half of INT_MAX: just what is asked.
+    if (capacity < count)
+        capacity = count;
+
+    return heap_resize(heap, capacity);
+}
+
+int heap_reserve(Heap* heap, int capacity) {
+
+    if (capacity <= heap->capacity)                                                 // Already large enough, never shrinks.
+        return 0;
+
+    return heap_resize(heap, capacity);
+}
+
+int heap_shrink_to_fit(Heap* heap) {
+
+    if (heap->capacity == heap_size(heap))
+        return 0;
+
+    return heap_resize(heap, heap_size(heap));
+}
+
+// Make sure count handles can be live at once, so heap_handle_new cannot fail.
+static int heap_handles_grow(Heap* heap, int count) {
+
+    int nhandles;
+    int* pos;
+
+    if (count <= heap->nhandles)
+        return 0;
+
+    nhandles = heap->nhandles == 0 ? HEAP_MIN_CAPACITY : heap->nhandles * 2;
+    if (nhandles < count)
+        nhandles = count;
+
+    if ((pos = (int*)realloc(heap->pos, (size_t)nhandles * sizeof(int))) == NULL)
+        return -1;
+
+    heap->pos = pos;
+
+    while (heap->nhandles < nhandles) {                                             // Push the new handles onto the free list.
+        heap->pos[heap->nhandles] = -2 - heap->freeh;
+        heap->freeh = heap->nhandles++;
+    }
+
+    return 0;
+}
+
+static int heap_handle_new(Heap* heap) {
+
+    int handle = heap->freeh;
+
+    heap->freeh = -2 - heap->pos[handle];
+
+    return handle;
+}
+
+static void heap_handle_free(Heap* heap, int handle) {
+
+    heap->pos[handle] = -2 - heap->freeh;
+    heap->freeh = handle;
+}
+
+int heap_enable_handles(Heap* heap) {
+
+    int i;
+
+    if (heap->ids != NULL)
+        return 0;
+
+    if ((heap->ids = (int*)malloc(((size_t)heap->capacity + 1) * sizeof(int))) == NULL)
+        return -1;
+
+    if (heap_handles_grow(heap, heap_size(heap)) != 0) {
+        free(heap->ids);
+        heap->ids = NULL;
+        return -1;
+    }
+
+    for (i = 0; i < heap_size(heap); i++) {                                         // Nodes already queued get handles in slot order.
+        heap->ids[i] = heap_handle_new(heap);
+        heap->pos[heap->ids[i]] = i;
+    }
+
+    return 0;
+}
+
+void heap_destroy(Heap* heap) {
+
+    int i;
+    if (heap->destroy != NULL) {
+
+        for (i = 0; i < heap_size(heap); i++) {
+            heap->destroy(heap_elem(heap, i));                                                              // A user-defined function to free dynamically allocated data.
+        }
+    }
+    else if (heap->alloc != NULL && heap->esize == 0) {
+
+        for (i = 0; i < heap_size(heap); i++)
+            heap->alloc->free(heap->alloc->ctx, heap->tree[i]);                                             // Elements go back where they came from.
+    }
+
+    heap_tree_free(heap);                                                                                   // Free the storage allocated for the heap.
+    free(heap->ids);
+    free(heap->pos);
+
+    memset(heap, 0, sizeof(Heap));                                                                          // Clear the structure to be on the safe side.
+
+    return;
+}
+
+// Copy one slot's worth of bytes from item, whose handle is id, into slot npos.
+static void heap_put(Heap* heap, int npos, const void* item, int id) {
+
+    heap_count(heap, moves, 1);
+
+    if (heap->esize == 0)
+        heap->tree[npos] = *(void* const*)item;
+    else
+        memcpy(heap_slot(heap, npos), item, heap->esize);
+
+    if (heap->ids != NULL) {
+        heap->ids[npos] = id;
+        heap->pos[id] = npos;
+    }
+}
+
+// Move slot spos into slot npos.
+static void heap_move(Heap* heap, int npos, int spos) {
+
+    heap_count(heap, moves, 1);
+
+    if (heap->esize == 0)
+        heap->tree[npos] = heap->tree[spos];
+    else
+        memcpy(heap_slot(heap, npos), heap_slot(heap, spos), heap->esize);
+
+    if (heap->ids != NULL) {
+        heap->ids[npos] = heap->ids[spos];
+        heap->pos[heap->ids[npos]] = npos;
+    }
+}
+
+// Place item at hole ipos and push it upward. Parents are moved down into the
+// hole instead of swapped, so item is written exactly once.
+static void heap_sift_up(Heap* heap, int ipos, const void* item, int id) {
+
+    const void* key = heap_item_key(heap, item);
+    int ppos;
+
+    heap_sift_begin(heap);
+
+    while (ipos > 0) {
+
+        ppos = heap_parent(heap, ipos);
+
+        if (heap_cmp(heap, heap_elem(heap, ppos), key) >= 0)
+            break;
+
+        heap_move(heap, ipos, ppos);                                                // Pull the parent down into the hole.
+        ipos = ppos;                                                                // Move up one level in the tree to continue heapifying.
+        heap_count(heap, sift_levels, 1);
+    }
+
+    heap_sift_end(heap);
+    heap_put(heap, ipos, item, id);
+}
+
+// Return the position of the largest child in the sibling group starting at cpos.
+static int heap_best_child(Heap* heap, int cpos) {
+
+    int epos;
+    int mpos;
+
+    epos = cpos + heap_arity(heap);
+    if (epos > heap_size(heap))
+        epos = heap_size(heap);
+
+    if (heap->select != NULL && epos - cpos == heap_arity(heap)) {
+        heap_count(heap, compares, heap_arity(heap) - 1);
+        return cpos + heap->select(heap_slot(heap, cpos));                         // One vector reduction over the whole group.
+    }
+
+    for (mpos = cpos++; cpos < epos; cpos++) {
+
+        if (heap_cmp(heap, heap_elem(heap, cpos), heap_elem(heap, mpos)) > 0)
+            mpos = cpos;
+    }
+
+    return mpos;
+}
+
+// Place item at hole ipos and push it downward within the first size slots.
+// item must not live in any of those slots.
+static void heap_sift_down(Heap* heap, int ipos, const void* item, int id) {
+
+    const void* key = heap_item_key(heap, item);
+    int cpos;
+    int mpos;
+
+    heap_sift_begin(heap);
+
+    while ((cpos = heap_child(heap, ipos)) < heap_size(heap)) {
+
+        mpos = heap_best_child(heap, cpos);                                         // Select the largest child of the sibling group.
+
+        if (heap_cmp(heap, heap_elem(heap, mpos), key) <= 0)
+            break;
+
+        heap_move(heap, ipos, mpos);                                                // Pull the child up into the hole.
+        ipos = mpos;                                                                // Move down one level in the tree to continue heapifying.
+        heap_count(heap, sift_levels, 1);
+    }
+
+    heap_sift_end(heap);
+    heap_put(heap, ipos, item, id);
+}
+
+// Bottom-up variant of heap_sift_down for an item that came from the bottom of the
+// tree: walk the hole down the path of largest children all the way to a leaf without
+// comparing against item, then climb back to item's place. The climb is usually one
+// or two steps, which saves about one comparison per level on drains.
+static void heap_sift_down_leaf(Heap* heap, int ipos, const void* item, int id) {
+
+    const void* key = heap_item_key(heap, item);
+    int hpos = ipos;
+    int cpos;
+    int ppos;
+
+    heap_sift_begin(heap);
+
+    while ((cpos = heap_child(heap, hpos)) < heap_size(heap)) {
+
+        cpos = heap_best_child(heap, cpos);
+        heap_move(heap, hpos, cpos);
+        hpos = cpos;
+        heap_count(heap, sift_levels, 1);
+    }
+
+    while (hpos > ipos) {
+
+        ppos = heap_parent(heap, hpos);
+
+        if (heap_cmp(heap, heap_elem(heap, ppos), key) >= 0)
+            break;
+
+        heap_move(heap, hpos, ppos);
+        hpos = ppos;
+        heap_count(heap, sift_levels, 1);
+    }
+
+    heap_sift_end(heap);
+    heap_put(heap, hpos, item, id);
+}
+
+// Halve the tree while it is at most a quarter full, never below HEAP_MIN_CAPACITY.
+// The gap between the grow (full) and shrink (1/4) points is the hysteresis that
+// keeps a heap hovering around one size from reallocating; batches call it once.
+static void heap_shrink(Heap* heap) {
+
+    int capacity = heap->capacity;
+
+    while (capacity > HEAP_MIN_CAPACITY && heap_size(heap) <= capacity / 4)
+        capacity = capacity / 2 > HEAP_MIN_CAPACITY ? capacity / 2 : HEAP_MIN_CAPACITY;
+
+    if (capacity != heap->capacity)
+        heap_resize(heap, capacity);                                                // On failure keep the larger tree.
+}
+
+int heap_insert(Heap* heap, const void* data) {
+
+    return heap_insert_handle(heap, data, NULL);
+}
+
+int heap_insert_handle(Heap* heap, const void* data, int* handle) {
+
+    unsigned long long t0 = latency_begin();
+    int id = -1;
+
+    if (heap_grow(heap, heap_size(heap) + 1) != 0)
+        return -1;
+
+    if (heap->ids != NULL) {                                                        // Issue a handle for the new node.
+
+        if (heap_handles_grow(heap, heap_size(heap) + 1) != 0)
+            return -1;
+        id = heap_handle_new(heap);
+    }
+
+    if (heap->esize == 0)                                                           // Insert after the last node and heapify upward.
+        heap_sift_up(heap, heap_size(heap), &data, id);
+    else
+        heap_sift_up(heap, heap_size(heap), data, id);
+
+    heap->size++;                                                                   // Adjust the size of the heap to account for the inserted node.
+    heap_count(heap, inserts, 1);
+    heap_count_peak(heap);
+
+    if (handle != NULL)
+        *handle = id;
+
+    latency_end(LAT_PQUEUE_INSERT, t0);
+
+    return 0;
+}
+
+int heap_extract(Heap* heap, void** data) {
+
+    unsigned long long t0 = latency_begin();
+
+    if (heap_size(heap) == 0)                                                       //  Do not allow extraction from an empty heap.
+        return -1;
+
+    if (heap->esize == 0)                                                           //  Extract the node at the top of the heap.
+        *data = heap->tree[0];
+    else
+        memcpy(data, heap->tree, heap->esize);
+
+    if (heap->ids != NULL)                                                          //  Its handle is no longer valid.
+        heap_handle_free(heap, heap->ids[0]);
+
+    heap->size--;                                                                   //  Adjust the size of the heap to account for the extracted node.
+    heap_count(heap, extracts, 1);
+
+    if (heap_size(heap) > 0)                                                        // Move the last node to the top and heapify downward.
+        heap_sift_down(heap, 0, heap_slot(heap, heap_size(heap)), heap_id(heap, heap_size(heap)));
+
+    if (heap->capacity > HEAP_MIN_CAPACITY && heap_size(heap) <= heap->capacity / 4)
+        heap_shrink(heap);                                                          // Shrink with hysteresis; on failure keep the larger tree.
+
+    latency_end(LAT_PQUEUE_EXTRACT, t0);
+
+    return 0;
+}
+
+int heap_insert_many(Heap* heap, void** items, int n) {
+
+    int i;
+
+    if (n < 0)
+        return -1;
+
+    if (n >= heap_size(heap))                                                       // Batch at least as large as the heap: O(size + n) rebuild wins.
+        return heap_build(heap, items, n);
+
+    if (heap_grow(heap, heap_size(heap) + n) != 0)                                  // At most one allocation for the whole batch.
+        return -1;
+
+    if (heap->ids != NULL && heap_handles_grow(heap, heap_size(heap) + n) != 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+
+        heap_sift_up(heap, heap_size(heap), (char*)items + (size_t)i * heap_width(heap),
+            heap->ids != NULL ? heap_handle_new(heap) : -1);
+        heap->size++;
+    }
+
+    heap_count(heap, inserts, n);
+    heap_count_peak(heap);
+
+    return 0;
+}
+
+int heap_extract_k(Heap* heap, void** data, int k) {
+
+    char* out = (char*)data;
+    int i;
+
+    if (k > heap_size(heap))
+        k = heap_size(heap);
+    if (k < 0)
+        k = 0;
+
+    for (i = 0; i < k; i++) {
+
+        memcpy(out + (size_t)i * heap_width(heap), heap->tree, heap_width(heap));  // Top of the heap into the next output slot.
+
+        if (heap->ids != NULL)
+            heap_handle_free(heap, heap->ids[0]);
+
+        heap->size--;
+
+        if (heap_size(heap) > 0)
+            heap_sift_down_leaf(heap, 0, heap_slot(heap, heap_size(heap)), heap_id(heap, heap_size(heap)));
+    }
+
+    heap_count(heap, extracts, k);
+    heap_shrink(heap);
+
+    return k;
+}
+
+// Trade the trees of two heaps, sizes and snapshot mappings included.
+static void heap_swap_trees(Heap* heap1, Heap* heap2) {
+
+    void** tree = heap1->tree;
+    void* map = heap1->map;
+    size_t map_bytes = heap1->map_bytes;
+    int size = heap1->size;
+    int capacity = heap1->capacity;
+
+    heap1->tree = heap2->tree;
+    heap1->map = heap2->map;
+    heap1->map_bytes = heap2->map_bytes;
+    heap1->size = heap2->size;
+    heap1->capacity = heap2->capacity;
+
+    heap2->tree = tree;
+    heap2->map = map;
+    heap2->map_bytes = map_bytes;
+    heap2->size = size;
+    heap2->capacity = capacity;
+}
+
+// heap_merge / heap_merge_remap. With remap, src's handles are translated to the
+// handles their nodes get in dst.
+static int heap_merge_into(Heap* dst, Heap* src, int* remap) {
+
+    int swapped = 0;
+    int levels, status, i, handle;
+
+    if (dst == src || dst->esize != src->esize || dst->keytype != src->keytype
+        || (dst->keytype == HEAP_KEY_NONE && dst->compare != src->compare))
+        return -1;
+
+    if (src->ids != NULL && (remap == NULL || dst->ids == NULL))                    // Never drop handles the caller may still hold.
+        return -1;
+
+    if (heap_size(src) == 0) {
+        for (i = 0; src->ids != NULL && i < src->nhandles; i++)
+            remap[i] = -1;
+        return 0;
+    }
+
+    if (src->ids != NULL) {                                                         // Both ways of appending hand out the next free
+
+        if (heap_handles_grow(dst, heap_size(dst) + heap_size(src)) != 0)          // handles in src's slot order, and with room for
+            return -1;                                                              // all of them the free list is not rebuilt: read
+
+        for (i = 0; i < src->nhandles; i++)                                         // the handles off it before they are taken.
+            remap[i] = -1;
+        for (i = 0, handle = dst->freeh; i < heap_size(src); i++, handle = -2 - dst->pos[handle])
+            remap[src->ids[i]] = handle;
+    }
+
+    if (heap_size(src) > heap_size(dst) && dst->ids == NULL && src->ids == NULL && dst->dshift == src->dshift) {
+        heap_swap_trees(dst, src);                                                  // Keep the larger tree, merge the smaller one in.
+        swapped = 1;
+    }
+
+    for (levels = 1; heap_size(dst) >> levels > 0; levels++)
+        ;
+
+    if (heap_size(src) * (long long)levels >= heap_size(dst))                       // Sifting src up would cost more than one O(n)
+        status = heap_build(dst, src->tree, heap_size(src));                        // heapify of both. src's tree is already an items
+    else                                                                            // array in either layout.
+        status = heap_insert_many(dst, src->tree, heap_size(src));
+
+    if (status != 0) {
+        if (swapped)
+            heap_swap_trees(dst, src);
+        return -1;
+    }
+
+    if (dst->seq < src->seq)                                                        // Later stable keys still rank after every merged one.
+        dst->seq = src->seq;
+
+    for (i = 0; src->ids != NULL && i < heap_size(src); i++)
+        heap_handle_free(src, src->ids[i]);
+
+    heap_count(src, extracts, heap_size(src));
+    src->size = 0;                                                                  // The elements belong to dst now: no destroy.
+    heap_shrink(src);
+
+    return 0;
+}
+
+int heap_merge(Heap* dst, Heap* src) {
+
+    return heap_merge_into(dst, src, NULL);
+}
+
+int heap_merge_remap(Heap* dst, Heap* src, int* remap) {
+
+    return heap_merge_into(dst, src, remap);
+}
+
+int heap_pushpop(Heap* heap, const void* data, void** out) {
+
+    const void* item = heap->esize == 0 ? (const void*)&data : data;
+
+    if (heap_size(heap) > 0 && heap_cmp(heap, heap_elem(heap, 0), heap_item_key(heap, item)) > 0)
+        return heap_replace(heap, data, out);                                       // The root beats data: swap them.
+
+    if (heap->esize == 0)                                                           // data would come straight back out.
+        *out = (void*)data;
+    else if ((const void*)out != data)
+        memcpy(out, data, heap->esize);
+
+    return 0;
+}
+
+int heap_replace(Heap* heap, const void* data, void** out) {
+
+    int id = -1;
+
+    if (heap_size(heap) == 0)
+        return -1;
+
+    if (heap->esize != 0) {                                                         // out may be data's buffer: take data aside first.
+        memcpy(heap_scratch(heap), data, heap->esize);
+        data = heap_scratch(heap);
+    }
+
+    if (heap->esize == 0)                                                           // Pass back the top.
+        *out = heap->tree[0];
+    else
+        memcpy(out, heap->tree, heap->esize);
+
+    if (heap->ids != NULL) {                                                        // The old top's handle is free, so the new node's
+        heap_handle_free(heap, heap->ids[0]);                                       // needs no allocation.
+        id = heap_handle_new(heap);
+    }
+
+    heap_count(heap, extracts, 1);
+    heap_count(heap, inserts, 1);
+
+    if (heap->esize == 0)                                                           // data is a random newcomer, so it mostly ends
+        heap_sift_down_leaf(heap, 0, &data, id);                                    // up near the leaves, like a bottom node would.
+    else
+        heap_sift_down_leaf(heap, 0, data, id);
+
+    return 0;
+}
+
+int heap_build(Heap* heap, void** items, int n) {
+
+    int ipos;
+
+    if (n < 0 || heap_grow(heap, heap_size(heap) + n) != 0)                         // At most one allocation for the whole batch.
+        return -1;
+
+    if (n == 0)
+        return 0;
+
+    if (heap->ids != NULL && heap_handles_grow(heap, heap_size(heap) + n) != 0)
+        return -1;
+
+    memcpy(heap_slot(heap, heap_size(heap)), items, (size_t)n * heap_width(heap));  // Append the items as they are.
+
+    for (ipos = heap_size(heap); heap->ids != NULL && ipos < heap_size(heap) + n; ipos++) {
+        heap->ids[ipos] = heap_handle_new(heap);
+        heap->pos[heap->ids[ipos]] = ipos;
+    }
+
+    heap->size += n;
+    heap_count(heap, inserts, n);
+    heap_count_peak(heap);
+
+    for (ipos = heap_parent(heap, heap_size(heap) - 1); ipos >= 0; ipos--) {        // Floyd: heapify every internal node bottom-up, O(n) in total.
+
+        memcpy(heap_scratch(heap), heap_slot(heap, ipos), heap_width(heap));        // Sift-down needs the moving node outside the tree.
+        heap_sift_down(heap, ipos, heap_scratch(heap), heap_id(heap, ipos));
+    }
+
+    return 0;
+}
+
+int heap_update(Heap* heap, int handle) {
+
+    const void* key;
+    int ipos;
+
+    if (!heap_handle_valid(heap, handle))
+        return -1;
+
+    ipos = heap->pos[handle];
+    memcpy(heap_scratch(heap), heap_slot(heap, ipos), heap_width(heap));            // Lift the node out, leaving a hole at ipos.
+    key = heap_item_key(heap, heap_scratch(heap));
+
+    if (ipos > 0 && heap_cmp(heap, heap_elem(heap, heap_parent(heap, ipos)), key) < 0)
+        heap_sift_up(heap, ipos, heap_scratch(heap), handle);                       // Key went up: it can only move toward the root.
+    else
+        heap_sift_down(heap, ipos, heap_scratch(heap), handle);
+
+    return 0;
+}
+
+int heap_remove(Heap* heap, int handle, void** data) {
+
+    const void* key;
+    int ipos;
+
+    if (!heap_handle_valid(heap, handle))
+        return -1;
+
+    ipos = heap->pos[handle];
+
+    if (heap->esize == 0)                                                           // Pass back the removed node.
+        *data = heap->tree[ipos];
+    else
+        memcpy(data, heap_slot(heap, ipos), heap->esize);
+
+    heap_handle_free(heap, handle);
+    heap->size--;
+    heap_count(heap, extracts, 1);
+
+    if (ipos < heap_size(heap)) {                                                   // Refill the hole with the last node, which may belong above or below it.
+
+        key = heap_item_key(heap, heap_slot(heap, heap_size(heap)));
+
+        if (ipos > 0 && heap_cmp(heap, heap_elem(heap, heap_parent(heap, ipos)), key) < 0)
+            heap_sift_up(heap, ipos, heap_slot(heap, heap_size(heap)), heap->ids[heap_size(heap)]);
+        else
+            heap_sift_down(heap, ipos, heap_slot(heap, heap_size(heap)), heap->ids[heap_size(heap)]);
+    }
+
+    if (heap->capacity > HEAP_MIN_CAPACITY && heap_size(heap) <= heap->capacity / 4)
+        heap_shrink(heap);
+
+    return 0;
+}
+
+int heap_stats(Heap* heap, HeapStats* stats) {
+
+#if HEAP_STATS
+    memcpy(stats, &heap->stats, sizeof(HeapStats));
+#else
+    memset(stats, 0, sizeof(HeapStats));
+#endif
+    stats->size = heap_size(heap);
+    stats->capacity = heap_capacity(heap);
+
+    return HEAP_STATS ? 0 : -1;
+}
+
+void heap_stats_reset(Heap* heap) {
+
+#if HEAP_STATS
+    memset(&heap->stats, 0, sizeof(HeapStats));
+    heap->stats.peak_size = heap_size(heap);
+#endif
+    (void)heap;
+}
+
+void heap_stats_dump(Heap* heap, const char* name) {
+
+    HeapStats stats;
+    long long ops;
+
+    if (heap_stats(heap, &stats) != 0) {
+        fprintf(stdout, "Heap %s: size=%d capacity=%d (built without HEAP_STATS)\n", name, stats.size, stats.capacity);
+        return;
+    }
+
+    ops = stats.inserts + stats.extracts > 0 ? stats.inserts + stats.extracts : 1;
+
+    fprintf(stdout, "Heap %s: size=%d peak=%d capacity=%d arity=%d reallocs=%lld\n", name, stats.size,
+        stats.peak_size, stats.capacity, heap_arity(heap), stats.reallocs);
+    fprintf(stdout, "    inserts=%lld extracts=%lld compares=%lld (%.1f/op) moves=%lld (%.1f/op)\n",
+        stats.inserts, stats.extracts, stats.compares, (double)stats.compares / ops, stats.moves, (double)stats.moves / ops);
+    fprintf(stdout, "    sift_levels=%lld (%.1f/op) sift_max=%lld\n",
+        stats.sift_levels, (double)stats.sift_levels / ops, stats.sift_max);
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////
+// Heap snapshots (heap_save / heap_load)
+/////////////////////////////////////////////////////////////////////////
+//
+// A snapshot file is the block heap_resize would allocate for capacity == size,
+// behind a 64-byte header:
+//
+//     [header 64][pad][slot 0 .. size-1][scratch slot]
+//
+// pad is heap_pad, so a page-aligned mapping of the file puts slot 1 on a cache
+// line just like an allocated tree, and the scratch slot is already there: the
+// mapping can serve as the tree unchanged. Fields are in the byte order of the
+// machine that wrote them; a file from the other byte order fails the magic.
+
+#define HEAP_FILE_MAGIC   0x51505048u                                           // "HPPQ"
+#define HEAP_FILE_VERSION 1
+#define HEAP_FILE_HEADER  64
+
+typedef struct HeapFileHeader_ {
+
+    unsigned int magic;
+    unsigned int version;
+    int esize;
+    int keytype;
+    int dshift;
+    int size;
+    unsigned int seq;
+    unsigned int reserved;
+    unsigned long long checksum;                                                // heap_checksum of the size slots
+    char spare[HEAP_FILE_HEADER - 40];                                          // zero
+
+} HeapFileHeader;
+
+// FNV-1a over 64-bit words (then the tail bytes): one multiply per 8 bytes keeps the
+// checksum pass of a load close to memory speed while still catching torn or
+// shuffled blocks.
+static unsigned long long heap_checksum(const char* data, size_t bytes) {
+
+    unsigned long long hash = 14695981039346656037ULL;
+    unsigned long long word;
+    size_t i;
+
+    for (i = 0; i + 8 <= bytes; i += 8) {
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+static size_t heap_file_bytes(int width, int size) {
+
+    return HEAP_FILE_HEADER + (HEAP_CACHE_LINE - width % HEAP_CACHE_LINE) % HEAP_CACHE_LINE
+        + (size_t)(size + 1) * width;
+}
+
+static int heap_file_zero(FILE* f, size_t bytes) {                                // Write bytes zero bytes.
+
+    static const char zero[HEAP_CACHE_LINE] = { 0 };
+    size_t chunk;
+
+    for (; bytes > 0; bytes -= chunk) {
+        chunk = bytes < sizeof(zero) ? bytes : sizeof(zero);
+        if (fwrite(zero, 1, chunk, f) != chunk)
+            return -1;
+    }
+
+    return 0;
+}
+
+// Flush f to disk and close it. Returns -1 if anything on the way failed.
+static int heap_file_close(FILE* f) {
+
+    int status = fflush(f) == 0 ? 0 : -1;
+
+#ifdef _WIN32
+    if (status == 0 && _commit(_fileno(f)) != 0)
+        status = -1;
+#else
+    if (status == 0 && fsync(fileno(f)) != 0)
+        status = -1;
+#endif
+
+    return fclose(f) == 0 ? status : -1;
+}
+
+int heap_dir_sync(const char* path) {
+
+#ifdef _WIN32
+    (void)path;                                                                     // NTFS journals the entry; nothing to flush.
+
+    return 0;
+#else
+    const char* slash = strrchr(path, '/');
+    size_t length = slash == NULL ? 0 : (size_t)(slash - path) + 1;                 // Keep the slash: "/" for a file at the root.
+    char* dir;
+    int fd, status;
+
+    if ((dir = (char*)malloc(length + 2)) == NULL)
+        return -1;
+    if (length == 0)
+        strcpy(dir, ".");
+    else {
+        memcpy(dir, path, length);
+        dir[length] = '\0';
+    }
+
+    fd = open(dir, O_RDONLY);
+    free(dir);
+    if (fd < 0)
+        return -1;
+
+    status = fsync(fd);
+    close(fd);
+
+    return status == 0 ? 0 : -1;
+#endif
+}
+
+int heap_save(Heap* heap, const char* path) {
+
+    HeapFileHeader header;
+    char* temp;
+    FILE* f;
+    size_t bytes = (size_t)heap_size(heap) * heap_width(heap);
+    int status = 0;
+
+    if (heap->esize == 0)                                                           // Pointers mean nothing in another process.
+        return -1;
+
+#ifdef _WIN32
+    if (heap->map != NULL && heap_resize(heap, heap->capacity) != 0)                // The view of a loaded snapshot keeps it open,
+        return -1;                                                                  // and MoveFileEx cannot replace an open file.
+#endif
+
+    memset(&header, 0, sizeof(HeapFileHeader));
+    header.magic = HEAP_FILE_MAGIC;
+    header.version = HEAP_FILE_VERSION;
+    header.esize = heap->esize;
+    header.keytype = heap->keytype;
+    header.dshift = heap->dshift;
+    header.size = heap_size(heap);
+    header.seq = heap->seq;
+    header.checksum = heap_checksum((const char*)heap->tree, bytes);
+
+    if ((temp = (char*)malloc(strlen(path) + 5)) == NULL)
+        return -1;
+    sprintf(temp, "%s.tmp", path);
+
+    if ((f = fopen(temp, "wb")) == NULL) {
+        free(temp);
+        return -1;
+    }
+
+    if (fwrite(&header, sizeof(HeapFileHeader), 1, f) != 1
+        || heap_file_zero(f, heap_pad(heap)) != 0
+        || (bytes > 0 && fwrite(heap->tree, 1, bytes, f) != bytes)
+        || heap_file_zero(f, heap_width(heap)) != 0)                                // The scratch slot.
+        status = -1;
+
+    if (heap_file_close(f) != 0)
+        status = -1;
+
+#ifdef _WIN32
+    if (status == 0 && !MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        status = -1;
+#else
+    if (status == 0 && (rename(temp, path) != 0 || heap_dir_sync(path) != 0))
+        status = -1;
+#endif
+
+    if (status != 0)
+        remove(temp);
+    free(temp);
+
+    return status;
+}
+
+// Map the whole file at path copy-on-write; NULL on failure.
+static char* heap_file_map(const char* path, size_t* bytes) {
+
+    char* map;
+#ifdef _WIN32
+    HANDLE file, mapping;
+    LARGE_INTEGER length;
+
+    if ((file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL))
+        == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (!GetFileSizeEx(file, &length) || length.QuadPart < HEAP_FILE_HEADER
+        || (mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL)) == NULL) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    map = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);                   // The view keeps file and mapping alive.
+    CloseHandle(mapping);
+    CloseHandle(file);
+    *bytes = (size_t)length.QuadPart;
+#else
+    struct stat st;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size < HEAP_FILE_HEADER) {
+        close(fd);
+        return NULL;
+    }
+
+    map = (char*)mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == (char*)MAP_FAILED)
+        return NULL;
+
+    madvise(map, (size_t)st.st_size, MADV_WILLNEED);                                // The checksum reads it all next.
+    *bytes = (size_t)st.st_size;
+#endif
+
+    return map;
+}
+
+int heap_load(Heap* heap, const char* path) {
+
+    HeapFileHeader header;
+    char* map;
+    char* tree;
+    size_t bytes;
+
+    if (heap_size(heap) != 0 || heap->esize == 0 || heap->ids != NULL)
+        return -1;
+
+    if ((map = heap_file_map(path, &bytes)) == NULL)
+        return -1;
+
+    memcpy(&header, map, sizeof(HeapFileHeader));
+    tree = map + HEAP_FILE_HEADER + heap_pad(heap);
+
+    if (header.magic != HEAP_FILE_MAGIC || header.version != HEAP_FILE_VERSION
+        || header.esize != heap->esize || header.keytype != heap->keytype
+        || header.dshift < 1 || header.dshift > 4 || header.size < 0
+        || bytes != heap_file_bytes(heap->esize, header.size)
+        || heap_checksum(tree, (size_t)header.size * heap->esize) != header.checksum) {
+        heap_unmap(map, bytes);
+        return -1;
+    }
+
+    heap_tree_free(heap);
+
+    heap->tree = (void**)tree;                                                      // Adopt the snapshot's tree as it is.
+    heap->map = map;
+    heap->map_bytes = bytes;
+    heap->size = header.size;
+    heap->capacity = header.size;
+    heap->seq = header.seq;
+    heap->dshift = header.dshift;
+    heap_select_kernel(heap);
+    heap_count_peak(heap);
+
+    return 0;
+}
+
+
+
+/////////////// end HEAP
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Circular Queue - Data Struct; cqueue.h
+///////////////////////////////
+//
+//    <------   queue   <------  enque(val)/push_back()
+//<--getfront()   x delqueue
+//   dequeue()
+//
+//   items:  [ 22 | -6 |    |    |    |    |    | 14 ]     capacity 8 (a power of two)
+//                       ^                        ^
+//                       rear & 7                 front & 7
+//
+// front and rear count every deQueue / enQueue since the last growth and are masked
+// with capacity - 1 to index items, so size is rear - front and wrapping is free.
+// A full ring doubles and is unwrapped into the new block; shrinkQueue moves the
+// values into the smallest ring that holds them.
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// struct Queue {
+//     int* items;
+//     int capacity;
+//     unsigned int front;
+//     unsigned int rear;
+//     const HeapAllocator* alloc;
+// };
+///////////////////////////////////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////
+// Public interface: Circular Queue API
+////////////////////////////////////////////
+// void initQueue(struct Queue* q)
+// void initQueue_alloc(struct Queue* q, const HeapAllocator* alloc)
+// void destroyQueue(struct Queue* q)
+// int enQueue(struct Queue* q, int value)
+// int deQueue(struct Queue* q)
+// int enQueue_n(struct Queue* q, const int* values, int n)
+// int deQueue_n(struct Queue* q, int* values, int max)
+// int shrinkQueue(struct Queue* q)
+// void displayQueue(struct Queue* q)
+// int statsQueue(struct Queue* q, QueueStats* stats)
+// void dumpStatsQueue(struct Queue* q, const char* name)
+////////////////////////////////////////////
+
+#define queue_slot(q, npos) ((q)->items[(npos) & ((q)->capacity - 1)])
+
+#if HEAP_STATS
+#define queue_count(q, field, n) ((void)((q)->stats.field += (n)))
+#define queue_count_peak(q) ((void)((q)->stats.peak < (int)queueSize(q) ? (q)->stats.peak = (int)queueSize(q) : 0))
+#else
+#define queue_count(q, field, n) ((void)0)
+#define queue_count_peak(q) ((void)0)
+#endif
+
+void initQueue(struct Queue* q) {
+
+    initQueue_alloc(q, NULL);
+}
+
+void initQueue_alloc(struct Queue* q, const HeapAllocator* alloc) {
+
+    q->items = NULL;
+    q->capacity = 0;
+    q->front = q->rear = 0;
+    q->alloc = alloc;
+#if HEAP_STATS
+    memset(&q->stats, 0, sizeof(QueueStats));
+#endif
+}
+
+// Release a ring block to wherever it came from.
+static void freeQueue(struct Queue* q, int* items) {
+
+    if (q->alloc != NULL)
+        q->alloc->free(q->alloc->ctx, items);
+    else
+        free(items);
+}
+
+void destroyQueue(struct Queue* q) {
+
+    if (q->items != NULL)
+        freeQueue(q, q->items);
+    initQueue_alloc(q, q->alloc);                                                   // Reusable with the same allocator.
+}
+
+// Move the values into a new ring of capacity slots (a power of two >= size, or 0),
+// unwrapping them to start at slot 0.
+static int resizeQueue(struct Queue* q, int capacity) {
+
+    int size = queueSize(q);
+    int first;
+    int* items = NULL;
+
+    if (capacity > 0) {
+        items = q->alloc != NULL ? (int*)q->alloc->alloc(q->alloc->ctx, (size_t)capacity * sizeof(int))
+            : (int*)malloc((size_t)capacity * sizeof(int));
+        if (items == NULL)
+            return -1;
+        queue_count(q, allocs, 1);
+    }
+
+    if (size > 0) {                                                                 // Oldest run up to the end of the block, then the wrapped rest.
+
+        first = q->capacity - (int)(q->front & (q->capacity - 1));
+        if (first > size)
+            first = size;
+        memcpy(items, &queue_slot(q, q->front), (size_t)first * sizeof(int));
+        memcpy(items + first, q->items, (size_t)(size - first) * sizeof(int));
+    }
+
+    if (q->items != NULL)
+        freeQueue(q, q->items);
+    q->items = items;
+    q->capacity = capacity;
+    q->front = 0;
+    q->rear = (unsigned int)size;
+
+    return 0;
+}
+
+static int growQueue(struct Queue* q, int count) {
+
+    int capacity = q->capacity == 0 ? HEAP_MIN_CAPACITY : q->capacity;
+
+    if (count <= q->capacity)
+        return 0;
+
+    while (capacity < count) {
+        if (capacity > INT_MAX / 2)
+            return -1;
+        capacity *= 2;
+    }
+
+    return resizeQueue(q, capacity);
+}
+
+int enQueue(struct Queue* q, int value) {
+
+    if (queueSize(q) == q->capacity && growQueue(q, q->capacity + 1) != 0)
+        return -1;
+
+    queue_slot(q, q->rear++) = value;                                               // Masked store; the counter wraps freely.
+    queue_count(q, enqueues, 1);
+    queue_count_peak(q);
+
+    return 0;
+}
+
+int deQueue(struct Queue* q)
+{
+    if (queueSize(q) == 0) {
+        printf("Queue is empty");
+        return INT_MIN;
+    }
+
+    queue_count(q, dequeues, 1);
+    return queue_slot(q, q->front++);
+}
+
+int enQueue_n(struct Queue* q, const int* values, int n) {
+
+    int first;
+
+    if (n <= 0)
+        return 0;
+
+    if (n > INT_MAX - queueSize(q) || growQueue(q, queueSize(q) + n) != 0)         // At most one growth for the whole batch.
+        return -1;
+
+    first = q->capacity - (int)(q->rear & (q->capacity - 1));                     // Up to the end of the block, then wrap to slot 0.
+    if (first > n)
+        first = n;
+    memcpy(&queue_slot(q, q->rear), values, (size_t)first * sizeof(int));
+    memcpy(q->items, values + first, (size_t)(n - first) * sizeof(int));
+    q->rear += (unsigned int)n;
+    queue_count(q, enqueues, n);
+    queue_count_peak(q);
+
+    return 0;
+}
+
+int deQueue_n(struct Queue* q, int* values, int max) {
+
+    int first;
+
+    if (max > queueSize(q))
+        max = queueSize(q);
+    if (max <= 0)
+        return 0;
+
+    first = q->capacity - (int)(q->front & (q->capacity - 1));
+    if (first > max)
+        first = max;
+    memcpy(values, &queue_slot(q, q->front), (size_t)first * sizeof(int));
+    memcpy(values + first, q->items, (size_t)(max - first) * sizeof(int));
+    q->front += (unsigned int)max;
+    queue_count(q, dequeues, max);
+
+    return max;
+}
+
+int shrinkQueue(struct Queue* q) {
+
+    int capacity = queueSize(q) == 0 ? 0 : HEAP_MIN_CAPACITY;
+
+    while (capacity < queueSize(q))                                                 // Smallest power of two that holds the values.
+        capacity *= 2;
+
+    return capacity < q->capacity ? resizeQueue(q, capacity) : 0;
+}
+
+// Function displaying the elements of Circular Queue 
+void displayQueue(struct Queue* q)
+{
+    unsigned int npos;
+
+    printf("\nElements in Circular Queue are: ");
+
+    for (npos = q->front; npos != q->rear; npos++)
+        printf(npos + 1 == q->rear ? "%d" : "%d ", queue_slot(q, npos));
+}
+
+int statsQueue(struct Queue* q, QueueStats* stats) {
+
+#if HEAP_STATS
+    memcpy(stats, &q->stats, sizeof(QueueStats));
+#else
+    memset(stats, 0, sizeof(QueueStats));
+#endif
+    stats->size = queueSize(q);
+    stats->capacity = q->capacity;
+
+    return HEAP_STATS ? 0 : -1;
+}
+
+void dumpStatsQueue(struct Queue* q, const char* name) {
+
+    QueueStats stats;
+
+    if (statsQueue(q, &stats) != 0) {
+        printf("Queue %s: size=%d capacity=%d (built without HEAP_STATS)\n", name, stats.size, stats.capacity);
+        return;
+    }
+
+    printf("Queue %s: size=%d peak=%d capacity=%d allocs=%lld enqueues=%lld dequeues=%lld\n", name,
+        stats.size, stats.peak, stats.capacity, stats.allocs, stats.enqueues, stats.dequeues);
+}
+
+/////////////////////////////////////////
+//
+// PQueue Data Struct - pqueue.h
+//
+/////////////////////////////////////////
+//
+// #define PQUEUE_HEAP   0
+// #define PQUEUE_RADIX  1
+// #define PQUEUE_BUCKET 2
+// #define PQUEUE_EXTERN 3
+//
+// #ifndef PQUEUE_BACKEND
+// #define PQUEUE_BACKEND PQUEUE_HEAP
+// #endif
+//
+// #if PQUEUE_BACKEND == PQUEUE_RADIX
+//
+// #include "radixheap.h"
+//
+// typedef RadixHeap PQueue;
+//
+//////////////////////////////////////////////////////////
+//// Public Interface: Priority Queue API (radix backend)
+//////////////////////////////////////////////////////////
+//
+//#define pqueue_init_keyed radix_init_keyed
+//
+//#define pqueue_destroy radix_destroy
+//
+//#define pqueue_insert radix_insert
+//
+//#define pqueue_extract radix_extract
+//
+//#define pqueue_from_array radix_insert_many
+//
+//#define pqueue_insert_many radix_insert_many
+//
+//#define pqueue_extract_k radix_extract_k
+//
+//#define pqueue_peek radix_peek
+//
+//#define pqueue_size radix_size
+//
+//#define pqueue_shrink_to_fit radix_shrink_to_fit
+//
+//#define pqueue_merge radix_merge
+//
+// #elif PQUEUE_BACKEND == PQUEUE_BUCKET
+//
+// #include "bucketqueue.h"
+//
+// typedef BucketQueue PQueue;
+//
+///////////////////////////////////////////////////////////
+//// Public Interface: Priority Queue API (bucket backend)
+///////////////////////////////////////////////////////////
+//
+//#define pqueue_init_keyed bucket_init_keyed
+//
+//#define pqueue_destroy bucket_destroy
+//
+//#define pqueue_insert bucket_insert
+//
+//#define pqueue_extract bucket_extract
+//
+//#define pqueue_from_array bucket_insert_many
+//
+//#define pqueue_insert_many bucket_insert_many
+//
+//#define pqueue_extract_k bucket_extract_k
+//
+//#define pqueue_peek bucket_peek
+//
+//#define pqueue_size bucket_size
+//
+//#define pqueue_shrink_to_fit bucket_shrink_to_fit
+//
+//#define pqueue_merge bucket_merge
+//
+// #elif PQUEUE_BACKEND == PQUEUE_EXTERN
+//
+// #include "extheap.h"
+//
+// typedef ExtHeap PQueue;
+//
+/////////////////////////////////////////////////////////////
+//// Public Interface: Priority Queue API (external backend)
+/////////////////////////////////////////////////////////////
+//
+//#define pqueue_init_keyed extheap_init_keyed
+//
+//#define pqueue_set_limit extheap_set_limit
+//
+//#define pqueue_set_dir extheap_set_dir
+//
+//#define pqueue_destroy extheap_destroy
+//
+//#define pqueue_insert extheap_insert
+//
+//#define pqueue_extract extheap_extract
+//
+//#define pqueue_from_array extheap_insert_many
+//
+//#define pqueue_insert_many extheap_insert_many
+//
+//#define pqueue_extract_k extheap_extract_k
+//
+//#define pqueue_peek extheap_peek
+//
+//#define pqueue_size extheap_size
+//
+//#define pqueue_shrink_to_fit extheap_shrink_to_fit
+//
+//#define pqueue_merge extheap_merge
+//
+// #else
+//
+// typedef Heap PQueue;
+//
+// #ifndef PQUEUE_ARITY
+// #define PQUEUE_ARITY 2
+// #endif
+//
+//////////////////////////////////////////
+//// Public Interface: Priority Queue API
+//////////////////////////////////////////
+//
+//#define pqueue_init(pqueue, compare, destroy) (heap_init((pqueue), (compare), (destroy)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+//
+//#define pqueue_init_alloc(pqueue, compare, alloc) (heap_init_alloc((pqueue), (compare), (alloc)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+//
+//#define pqueue_init_sized(pqueue, esize, compare) (heap_init_sized((pqueue), (esize), (compare)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+//
+//#define pqueue_init_keyed(pqueue, esize, keytype) (heap_init_keyed((pqueue), (esize), (keytype)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+//
+//#define pqueue_destroy heap_destroy
+//
+//#define pqueue_stats heap_stats
+//
+//#define pqueue_stats_dump heap_stats_dump
+//
+//#define pqueue_insert heap_insert
+//
+//#define pqueue_extract heap_extract
+//
+//#define pqueue_from_array heap_build
+//
+//#define pqueue_insert_many heap_insert_many
+//
+//#define pqueue_extract_k heap_extract_k
+//
+//#define pqueue_merge heap_merge
+//
+//#define pqueue_pushpop heap_pushpop
+//
+//#define pqueue_replace heap_replace
+//
+//#define pqueue_peek(pqueue) ((pqueue)->size == 0 ? NULL : heap_elem(pqueue, 0))
+//
+//#define pqueue_size heap_size
+//
+//#define pqueue_reserve heap_reserve
+//
+//#define pqueue_shrink_to_fit heap_shrink_to_fit
+//
+//#define pqueue_save heap_save
+//
+//#define pqueue_load heap_load
+//
+//#define pqueue_enable_handles heap_enable_handles
+//
+//#define pqueue_insert_handle heap_insert_handle
+//
+//#define pqueue_update heap_update
+//
+//#define pqueue_remove heap_remove
+//
+//#define pqueue_merge_remap heap_merge_remap
+//
+//#define pqueue_handle_elem heap_handle_elem
+//
+// #endif
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////
+// Application of Priority Queue in Post Office Parcel Mgmt
+// Publick Interface: Parcel API
+// void parcels_init(PQueue *parcels)
+// void parcels_init_stable(PQueue *parcels)
+// int get_parcel(PQueue *parcels, Parcel *parcel) 
+// int put_parcel(PQueue *parcels, const Parcel *parcel)
+// int load_parcels(PQueue *parcels, const Parcel *items, int n)
+// int get_parcels(PQueue *parcels, Parcel *out, int max)
+// int put_parcels(PQueue *parcels, const Parcel *items, int n)
+// int parcels_topk_init(ParcelTopK *topk, int k)
+// void parcels_topk_destroy(ParcelTopK *topk)
+// int topk_put_parcel(ParcelTopK *topk, const Parcel *parcel)
+// int topk_put_parcels(ParcelTopK *topk, const Parcel *items, int n)
+// int topk_get_parcels(ParcelTopK *topk, Parcel *out, int max)
+// int put_parcel_handle(PQueue *parcels, const Parcel *parcel, int *handle)
+// int reprioritize_parcel(PQueue *parcels, int handle, int priority)
+// int cancel_parcel(PQueue *parcels, int handle, Parcel *parcel)
+///////////////////////////////////////////////////////////
+
+// Storage for one pointer-mode Parcel, from the queue's allocator when it has one.
+static Parcel* parcels_new(PQueue* parcels) {
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    if (parcels->alloc != NULL)
+        return (Parcel*)parcels->alloc->alloc(parcels->alloc->ctx, sizeof(Parcel));
+#else
+    (void)parcels;                                                                  // Only heaps take an allocator.
+#endif
+    return (Parcel*)malloc(sizeof(Parcel));
+}
+
+static void parcels_delete(PQueue* parcels, Parcel* data) {
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    if (parcels->alloc != NULL) {
+        parcels->alloc->free(parcels->alloc->ctx, data);
+        return;
+    }
+#else
+    (void)parcels;
+#endif
+    free(data);
+}
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP                                                   // Stable keys need a Heap (arbitrary 64-bit priorities).
+
+#define parcels_stable(parcels) ((parcels)->esize == (int)sizeof(StableParcel))
+
+static int parcels_seq_compare(const void* slot1, const void* slot2) {             // Oldest first.
+
+    unsigned int seq1 = heap_stable_seq((*(StableParcel* const*)slot1)->key);
+    unsigned int seq2 = heap_stable_seq((*(StableParcel* const*)slot2)->key);
+
+    return (seq1 > seq2) - (seq1 < seq2);
+}
+
+// Make sure count more sequence numbers fit: once the counter would run out, renumber
+// the queued parcels 0 .. size-1 oldest first. Relative order is kept, so the keys
+// still compare the same way and the heap (and its handles) stay valid as they are.
+static int parcels_seq_reserve(PQueue* parcels, int count) {
+
+    StableParcel** order;
+    int n = pqueue_size(parcels);
+    int i;
+
+    if (parcels->seq <= UINT_MAX - (unsigned int)count)
+        return 0;
+
+    if ((order = (StableParcel**)malloc((n > 0 ? n : 1) * sizeof(StableParcel*))) == NULL)
+        return -1;
+
+    for (i = 0; i < n; i++)
+        order[i] = (StableParcel*)heap_elem(parcels, i);
+    qsort(order, n, sizeof(StableParcel*), parcels_seq_compare);
+
+    for (i = 0; i < n; i++)
+        order[i]->key = heap_stable_key(order[i]->parcel.priority, i);
+    parcels->seq = (unsigned int)n;
+
+    free(order);
+
+    return 0;
+}
+
+static void parcels_pack(PQueue* parcels, StableParcel* slot, const Parcel* parcel) {
+
+    memset(slot, 0, sizeof(StableParcel));                                      // No stray padding bytes in the tree.
+    slot->key = heap_stable_key(parcel->priority, parcels->seq++);
+    memcpy(&slot->parcel, parcel, sizeof(Parcel));
+}
+
+// Pack n parcels, in arrival order, into a malloc'd array of slots.
+static StableParcel* parcels_pack_n(PQueue* parcels, const Parcel* items, int n) {
+
+    StableParcel* slots;
+    int i;
+
+    if (n < 0 || parcels_seq_reserve(parcels, n) != 0
+        || (slots = (StableParcel*)malloc((n > 0 ? n : 1) * sizeof(StableParcel))) == NULL)
+        return NULL;
+
+    for (i = 0; i < n; i++)
+        parcels_pack(parcels, &slots[i], &items[i]);
+
+    return slots;
+}
+
+void parcels_init_stable(PQueue* parcels) {
+
+    pqueue_init_keyed(parcels, sizeof(StableParcel), HEAP_KEY_I64);            // One int64 compare on the packed key per step.
+
+    return;
+}
+
+#endif // PQUEUE_BACKEND
+
+void parcels_init(PQueue* parcels) {
+
+    pqueue_init_keyed(parcels, sizeof(Parcel), HEAP_KEY_I32);                  // Parcels live inside the tree keyed on priority (offset 0): no
+                                                                                // per-parcel malloc/free and no compare calls.
+
+    return;
+}
+
+static int parcels_get(PQueue* parcels, Parcel* parcel) {
+
+    Parcel* data;
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    StableParcel slot;
+#endif
+
+    if (pqueue_size(parcels) == 0)
+        return -1;
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    else if (parcels_stable(parcels)) {     // Stable: unwrap the parcel from its slot.
+
+        if (pqueue_extract(parcels, (void**)&slot) != 0)
+            return -1;
+        memcpy(parcel, &slot.parcel, sizeof(Parcel));
+    }
+#endif
+    else if (parcels->esize != 0) {     // Stored by value: copy straight out of the tree.
+
+        return pqueue_extract(parcels, (void**)parcel);
+    }
+    else {       // That parcel could not be retrieved, return -1:
+
+        if (pqueue_extract(parcels, (void**)&data) != 0)
+            return -1;
+        else {   // Pass back the highest-priority parcel:
+
+            memcpy(parcel, data, sizeof(Parcel));
+            parcels_delete(parcels, data);
+        }
+    }
+
+    return 0;
+}
+
+static int parcels_put(PQueue* parcels, const Parcel* parcel) {
+
+    Parcel* data;
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    StableParcel slot;
 
-#define heap_parent(npos) ((int)(((npos) - 1) / 2))
+    if (parcels_stable(parcels)) {                                              // Stable: stamp the arrival order into the key.
 
-#define heap_left(npos) (((npos) * 2) + 1)
+        if (parcels_seq_reserve(parcels, 1) != 0)
+            return -1;
+        parcels_pack(parcels, &slot, parcel);
+        return pqueue_insert(parcels, &slot);
+    }
+#endif
 
-#define heap_right(npos) (((npos) * 2) + 2)
+    if (parcels->esize != 0)                                                    // Stored by value: the heap copies the parcel.
+        return pqueue_insert(parcels, parcel);
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Public interface: Heap API
-////////////////////////////////
-// void heap_init(Heap* heap, int (*compare)(const void* key1, const void* key2),  void (*destroy)(void* data))
-// void heap_destroy(Heap* heap)
-// int  heap_insert(Heap* heap, const void* data)
-// int  heap_extract(Heap* heap, void** data)
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    if ((data = parcels_new(parcels)) == NULL)                                  // Allocate storage for the parcel.
+        return -1;
+
+    memcpy(data, parcel, sizeof(Parcel));
 
+    if (pqueue_insert(parcels, data) != 0) {                                    // Insert the parcel into the priority queue.
+        parcels_delete(parcels, data);
+        return -1;
+    }
 
-void heap_init(Heap* heap, int (*compare)(const void* key1, const void* key2),  void (*destroy)(void* data)) {
+    return 0;
+}
 
-    heap->size = 0;
-    heap->compare = compare;
-    heap->destroy = destroy;
-    heap->tree = NULL;
+int get_parcel(PQueue* parcels, Parcel* parcel) {
 
-    return;
+    unsigned long long t0 = latency_begin();                                    // Timed as a whole, including any free.
+    int status = parcels_get(parcels, parcel);
+
+    latency_end(LAT_GET_PARCEL, t0);
+
+    return status;
 }
 
-void heap_destroy(Heap* heap) {
+int put_parcel(PQueue* parcels, const Parcel* parcel) {
 
+    unsigned long long t0 = latency_begin();
+    int status = parcels_put(parcels, parcel);
+
+    latency_end(LAT_PUT_PARCEL, t0);
+
+    return status;
+}
+
+// Copy n parcels into individually allocated Parcels for pointer-mode queues.
+static Parcel** parcels_alloc(PQueue* parcels, const Parcel* items, int n) {
+
+    Parcel** data;
     int i;
-    if (heap->destroy != NULL) {
 
-        for (i = 0; i < heap_size(heap); i++) {
-            heap->destroy(heap->tree[i]);                                                                   // A user-defined function to free dynamically allocated data.
+    if (n < 0 || (data = (Parcel**)malloc((n > 0 ? n : 1) * sizeof(Parcel*))) == NULL)
+        return NULL;
+
+    for (i = 0; i < n; i++) {                                                   // Allocate storage for every parcel up front.
+
+        if ((data[i] = parcels_new(parcels)) == NULL) {
+
+            while (i > 0)
+                parcels_delete(parcels, data[--i]);
+            free(data);
+            return NULL;
         }
+        memcpy(data[i], &items[i], sizeof(Parcel));
     }
 
-    free(heap->tree);                                                                                       // Free the storage allocated for the heap.
+    return data;
+}
 
-    memset(heap, 0, sizeof(Heap));                                                                          // Clear the structure to be on the safe side.
+static void parcels_free(PQueue* parcels, Parcel** data, int n) {
 
-    return;
+    while (n > 0)
+        parcels_delete(parcels, data[--n]);
+    free(data);
 }
 
-int heap_insert(Heap* heap, const void* data) {
+int load_parcels(PQueue* parcels, const Parcel* items, int n) {
 
-    void* temp;
+    Parcel** data;
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    StableParcel* slots;
+    int status;
 
-    int ipos;
-    int  ppos;
+    if (parcels_stable(parcels)) {                                              // Stable: stamp items in array order, then add.
 
-    if ((temp = (void**)realloc(heap->tree, (heap_size(heap) + 1) * sizeof(void*))) == NULL) {
+        if ((slots = parcels_pack_n(parcels, items, n)) == NULL)
+            return -1;
+        status = pqueue_from_array(parcels, (void**)slots, n);
+        free(slots);
+        return status;
+    }
+#endif
+
+    if (parcels->esize != 0)                                                    // Stored by value: heapify a straight copy of items.
+        return pqueue_from_array(parcels, (void**)items, n);
+
+    if ((data = parcels_alloc(parcels, items, n)) == NULL)
+        return -1;
+
+    if (pqueue_from_array(parcels, (void**)data, n) != 0) {
+        parcels_free(parcels, data, n);
         return -1;
-    } else {
-        heap->tree = temp;
     }
 
-    heap->tree[heap_size(heap)] = (void*)data;                                      //  Insert the node after the last node.       
+    free(data);
 
-    ipos = heap_size(heap);                                                         // Heapify the tree by pushing the contents of the new node upward.
-    ppos = heap_parent(ipos);
+    return 0;
+}
 
-    while (ipos > 0 && heap->compare(heap->tree[ppos], heap->tree[ipos]) < 0) {
+int put_parcels(PQueue* parcels, const Parcel* items, int n) {
 
-        temp = heap->tree[ppos];                                                    // Swap the contents of the current node and its parent.
-        heap->tree[ppos] = heap->tree[ipos];
-        heap->tree[ipos] = temp;
+    Parcel** data;
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    StableParcel* slots;
+    int status;
 
-        ipos = ppos;                                                                // Move up one level in the tree to continue heapifying.
-        ppos = heap_parent(ipos);
+    if (parcels_stable(parcels)) {                                              // Stable: stamp items in array order, then add.
 
+        if ((slots = parcels_pack_n(parcels, items, n)) == NULL)
+            return -1;
+        status = pqueue_insert_many(parcels, (void**)slots, n);
+        free(slots);
+        return status;
     }
+#endif
 
-    heap->size++;                                                                   // Adjust the size of the heap to account for the inserted node.
+    if (parcels->esize != 0)                                                    // Stored by value: the heap copies the parcels.
+        return pqueue_insert_many(parcels, (void**)items, n);
+
+    if ((data = parcels_alloc(parcels, items, n)) == NULL)
+        return -1;
+
+    if (pqueue_insert_many(parcels, (void**)data, n) != 0) {
+        parcels_free(parcels, data, n);
+        return -1;
+    }
+
+    free(data);
 
     return 0;
 }
 
-int heap_extract(Heap* heap, void** data) {
-
-    void* save;
-    void* temp;
+int get_parcels(PQueue* parcels, Parcel* out, int max) {
 
-    int ipos;
-    int lpos;
-    int rpos;
-    int mpos;
+    Parcel** data;
+    int count;
+    int i;
 
-    if (heap_size(heap) == 0)                                                       //  Do not allow extraction from an empty heap.
-        return -1;
+    if (max <= 0)
+        return 0;
 
-    *data = heap->tree[0];                                                          //  Extract the node at the top of the heap.  
+    if (max > pqueue_size(parcels))
+        max = (int)pqueue_size(parcels);
 
-    save = heap->tree[heap_size(heap) - 1];                                         //  Adjust the storage used by the heap.
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+    if (parcels_stable(parcels)) {                                              // Stable: extract the slots, then unwrap them.
 
-    if (heap_size(heap) - 1 > 0) {
+        StableParcel* slots;
 
-        if ((temp = (void**)realloc(heap->tree, (heap_size(heap) - 1) * sizeof(void*))) == NULL) {
+        if ((slots = (StableParcel*)malloc((max > 0 ? max : 1) * sizeof(StableParcel))) == NULL)
             return -1;
-        } else {
-            heap->tree = temp;
-        }
+        count = pqueue_extract_k(parcels, (void**)slots, max);
+        for (i = 0; i < count; i++)
+            memcpy(&out[i], &slots[i].parcel, sizeof(Parcel));
+        free(slots);
+        return count;
+    }
+#endif
+
+    if (parcels->esize != 0)                                                    // Stored by value: copy straight out of the tree.
+        return pqueue_extract_k(parcels, (void**)out, max);
 
-        heap->size--;                                                               //  Adjust the size of the heap to account for the extracted node.
+    if ((data = (Parcel**)malloc((max > 0 ? max : 1) * sizeof(Parcel*))) == NULL)
+        return -1;
 
-    } else {
+    count = pqueue_extract_k(parcels, (void**)data, max);
 
-        free(heap->tree);                                                           // Manage the heap when extracting the last node.
-        heap->tree = NULL;
-        heap->size = 0;
-        return 0;
+    for (i = 0; i < count; i++) {                                               // Pass back the parcels, highest priority first.
+        memcpy(&out[i], data[i], sizeof(Parcel));
+        parcels_delete(parcels, data[i]);
     }
 
-    heap->tree[0] = save;                                                           // Copy the last node to the top.
+    free(data);
 
-    ipos = 0;                                                                       // Heapify the tree by pushing the contents of the new top downward.
-    lpos = heap_left(ipos);
-    rpos = heap_right(ipos);
+    return count;
+}
 
-    while (1) {
+int parcels_topk_init(ParcelTopK* topk, int k) {
 
-        lpos = heap_left(ipos);                                                     //  Select the child to swap with the current node.
-        rpos = heap_right(ipos);
+    heap_init_keyed(&topk->best, sizeof(Parcel), HEAP_KEY_I32);                // The root is the highest ~priority: the lowest priority.
+    topk->k = k;
+    topk->offered = 0;
+    topk->rejected = 0;
 
-        if (lpos < heap_size(heap) && heap->compare(heap->tree[lpos], heap->tree[ipos]) > 0) {
-            mpos = lpos;
-        } else {
-            mpos = ipos;
-        }
+    if (k < 1 || heap_reserve(&topk->best, k) != 0)                             // The stream never reallocates after this.
+        return -1;
 
-        if (rpos < heap_size(heap) && heap->compare(heap->tree[rpos], heap->tree[mpos]) > 0) {
-            mpos = rpos;
-        }
+    return 0;
+}
 
-        if (mpos == ipos) {
-            break;
-        } else {
+void parcels_topk_destroy(ParcelTopK* topk) {
 
-            temp = heap->tree[mpos];                                                    // Swap the contents of the current node and the selected child.
-            heap->tree[mpos] = heap->tree[ipos];
-            heap->tree[ipos] = temp;
+    heap_destroy(&topk->best);
 
-            ipos = mpos;                                                                //  Move down one level in the tree to continue heapifying.  
-        }
-    }
-    return 0;
+    return;
 }
 
+int topk_put_parcel(ParcelTopK* topk, const Parcel* parcel) {
 
+    Parcel slot;
 
-/////////////// end HEAP
+    memcpy(&slot, parcel, sizeof(Parcel));
+    slot.priority = ~slot.priority;                                             // Order-reversing and, unlike negation, total on int.
+    topk->offered++;
 
+    if (heap_size(&topk->best) < topk->k)                                       // Still filling up: keep everything.
+        return heap_insert(&topk->best, &slot);
 
-///////////////////////
-// Utility Functions
-///////////////////////
+    if (slot.priority >= ((Parcel*)heap_elem(&topk->best, 0))->priority) {      // No higher than the weakest kept: turn it away.
+        topk->rejected++;
+        return 0;
+    }
 
-static void print_heap(Heap* heap) {
+    return heap_replace(&topk->best, &slot, (void**)&slot);                     // Evict the weakest, sift the newcomer down.
+}
 
-    int i;
+int topk_put_parcels(ParcelTopK* topk, const Parcel* items, int n) {
 
-    fprintf(stdout, "Heap size is %d\n", heap_size(heap));
+    int i;
 
-    for (i = 0; i < heap_size(heap); i++)
-        fprintf(stdout, "Node=%03d\n", *(int*)heap->tree[i]);
+    for (i = 0; i < n; i++)
+        if (topk_put_parcel(topk, &items[i]) != 0)
+            return -1;
 
-    return;
+    return 0;
 }
 
+int topk_get_parcels(ParcelTopK* topk, Parcel* out, int max) {
 
-static int compare_int(const void* int1, const void* int2) {
-
-    if (*(const int*)int1 > * (const int*)int2)
-        return 1;
-    else if (*(const int*)int1 < *(const int*)int2)
-        return -1;
-    else
-        return 0;
-}
+    Parcel slot;
+    int count, i;
 
-static void print_pqueue(PQueue* pqueue) {
+    while (heap_size(&topk->best) > (max > 0 ? max : 0))                        // Drop the lowest ones that do not fit.
+        heap_extract(&topk->best, (void**)&slot);
 
-    int i;
+    count = heap_extract_k(&topk->best, (void**)out, heap_size(&topk->best));   // Lowest first: reverse, restoring priorities.
 
-    fprintf(stdout, "Priority queue size is %d\n", pqueue_size(pqueue));
+    for (i = 0; i < count - 1 - i; i++) {
+        memcpy(&slot, &out[i], sizeof(Parcel));
+        memcpy(&out[i], &out[count - 1 - i], sizeof(Parcel));
+        memcpy(&out[count - 1 - i], &slot, sizeof(Parcel));
+    }
+    for (i = 0; i < count; i++)
+        out[i].priority = ~out[i].priority;
 
-    for (i = 0; i < pqueue_size(pqueue); i++)
-        fprintf(stdout, "Node=%03d\n", *(int*)pqueue->tree[i]);
+    topk->offered = 0;
+    topk->rejected = 0;
+    heap_reserve(&topk->best, topk->k);                                         // Extract shrank the tree; keep the stream realloc-free.
 
-    return;
+    return count;
 }
 
+#if PQUEUE_BACKEND == PQUEUE_HEAP                                                   // Handles are a Heap feature.
 
+int put_parcel_handle(PQueue* parcels, const Parcel* parcel, int* handle) {
 
-////////////////////////////////////////////////////////////////////////////////////////////
-// Circular Queue - Data Struct; cqueue.h
-///////////////////////////////
-//
-//    <------   queue   <------  enque(val)/push_back()
-//<--getfront()   x delqueue
-//   dequeue()
-// front rear
-//    f  r           f    r              f            r
-//    |  |           |    |              |            |
-//    v  v           v    v              v            v
-//   -> 14 -      -> 14 -> 22 -         ->14 -> 22 -> -6-
-//  | ---- |     |-------------|       | ----------------|
-//  enqueue(14)       enqueue(22)         enqueue(-6)
-// 
-// 
-//                                     dequeue()/pop() (14) => like middle drawing
-///////////////////////////////////////////////////////////////////////////////////////////
-//
-// struct Node {
-//     int data;
-//     struct Node* next;
-// };
-//
-// struct Queue {
-//     struct Node* front;
-//     struct Node* rear;
-// };
-///////////////////////////////////////////////////////////////////////////////////////////
+    Parcel* data;
+    StableParcel slot;
 
+    if (parcels->ids == NULL && pqueue_enable_handles(parcels) != 0)            // First tracked parcel makes the queue addressable.
+        return -1;
 
-////////////////////////////////////////////
-// Public interface: Circular Queue API
-////////////////////////////////////////////
-// void enQueue(struct Queue* q, int value)
-// int deQueue(struct Queue* q)
-// void displayQueue(struct Queue* q)
-////////////////////////////////////////////
+    if (parcels_stable(parcels)) {
 
-// create circular queue
-void
-enQueue(struct Queue* q, int value) {
+        if (parcels_seq_reserve(parcels, 1) != 0)
+            return -1;
+        parcels_pack(parcels, &slot, parcel);
+        return pqueue_insert_handle(parcels, &slot, handle);
+    }
 
-    struct Node* pnew = (struct Node*)malloc(sizeof(struct Node));       // actual memory alloc, pair malloc-free, new-delete
-    pnew->data = value;
+    if (parcels->esize != 0)                                                    // Stored by value: the heap copies the parcel.
+        return pqueue_insert_handle(parcels, parcel, handle);
 
-    if (q->front == NULL)       // empty queue, upd front
-        q->front = pnew;
-    else                        // queue not empty, upd back 
-        q->rear->next = pnew;
+    if ((data = parcels_new(parcels)) == NULL)
+        return -1;
 
-    q->rear = pnew;             // upd back
-    q->rear->next = q->front;   // upd front
-}
+    memcpy(data, parcel, sizeof(Parcel));
 
-int deQueue(struct Queue* q)
-{
-    if (q->front == NULL) {
-        printf("Queue is empty");
-        return INT_MIN;
+    if (pqueue_insert_handle(parcels, data, handle) != 0) {
+        parcels_delete(parcels, data);
+        return -1;
     }
 
-    int value; // Value to be dequeued 
+    return 0;
+}
 
-    if (q->front == q->rear) {                // If this is the last node to be deleted
+int reprioritize_parcel(PQueue* parcels, int handle, int priority) {
 
-        value = q->front->data;
-        free(q->front);
-        q->front = NULL;
-        q->rear = NULL;
+    StableParcel* slot;
 
-    }
-    else {                                  // more than one node in the queue
+    if (parcels->ids == NULL || handle < 0 || handle >= parcels->nhandles || parcels->pos[handle] < 0)
+        return -1;
 
-        struct Node* cur = q->front;
-        value = cur->data;
-        q->front = q->front->next;
-        q->rear->next = q->front;
-        free(cur);
+    if (parcels_stable(parcels)) {                                              // Keep the parcel's place among its new peers by arrival.
 
+        slot = (StableParcel*)pqueue_handle_elem(parcels, handle);
+        slot->parcel.priority = priority;
+        slot->key = heap_stable_key(priority, heap_stable_seq(slot->key));
+        return pqueue_update(parcels, handle);
     }
 
-    return value;
+    ((Parcel*)pqueue_handle_elem(parcels, handle))->priority = priority;        // Rewrite the key in place, then let the heap re-sift it.
+
+    return pqueue_update(parcels, handle);
 }
 
-// Function displaying the elements of Circular Queue 
-void displayQueue(struct Queue* q)
-{
-    struct Node* cur = q->front;
-    printf("\nElements in Circular Queue are: ");
+int cancel_parcel(PQueue* parcels, int handle, Parcel* parcel) {
+
+    Parcel* data;
+    Parcel save;
+    StableParcel slot;
+
+    if (parcels_stable(parcels)) {
 
-    while (cur->next != q->front) {
-        printf("%d ", cur->data);
-        cur = cur->next;
+        if (pqueue_remove(parcels, handle, (void**)&slot) != 0)
+            return -1;
+        if (parcel != NULL)
+            memcpy(parcel, &slot.parcel, sizeof(Parcel));
+        return 0;
     }
-    printf("%d", cur->data);
+
+    if (parcels->esize != 0)                                                    // Stored by value: copy straight out of the tree.
+        return pqueue_remove(parcels, handle, (void**)(parcel != NULL ? parcel : &save));
+
+    if (pqueue_remove(parcels, handle, (void**)&data) != 0)
+        return -1;
+
+    if (parcel != NULL)                                                         // Pass back the withdrawn parcel.
+        memcpy(parcel, data, sizeof(Parcel));
+    parcels_delete(parcels, data);
+
+    return 0;
 }
 
-/////////////////////////////////////////
-//
-// PQueue Data Struct - pqueue.h
-//
-/////////////////////////////////////////
-//
-// typedef Heap PQueue;
-//
-//////////////////////////////////////////
-//// Public Interface: Priority Queue API
-//////////////////////////////////////////
-//
-//#define pqueue_init heap_init
-//
-//#define pqueue_destroy heap_destroy
-//
-//#define pqueue_insert heap_insert
-//
-//#define pqueue_extract heap_extract
-//
-//#define pqueue_peek(pqueue) ((pqueue)->tree == NULL ? NULL : (pqueue)->tree[0])
-//
-//#define pqueue_size heap_size
-//
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif // PQUEUE_BACKEND
 
-///////////////////////////////////////////////////////////
-// Application of Priority Queue in Post Office Parcel Mgmt
-// Publick Interface: Parcel API
-// int get_parcel(PQueue *parcels, Parcel *parcel) 
-// int put_parcel(PQueue *parcels, const Parcel *parcel)
-///////////////////////////////////////////////////////////
 
-int get_parcel(PQueue* parcels, Parcel* parcel) {
+////////////////
+// MAINLINE
+////////////////
+#ifndef HEAP_PQUEUE_NO_MAIN                                                         // Defined by projects that link this file as a library (Heap-PQueue-Bench).
 
-    Parcel* data;
+///////////////////////
+// Utility Functions
+///////////////////////
 
-    if (pqueue_size(parcels) == 0)
-        return -1;
-    else {       // That parcel could not be retrieved, return -1:
+static void print_heap(Heap* heap) {
 
-        if (pqueue_extract(parcels, (void**)&data) != 0)
-            return -1;
-        else {   // Pass back the highest-priority parcel:
+    int i;
 
-            memcpy(parcel, data, sizeof(Parcel));
-            free(data);
-        }
-    }
+    fprintf(stdout, "Heap size is %d\n", heap_size(heap));
 
-    return 0;
+    for (i = 0; i < heap_size(heap); i++)
+        fprintf(stdout, "Node=%03d\n", *(int*)heap->tree[i]);
+
+    return;
 }
 
-int put_parcel(PQueue* parcels, const Parcel* parcel) {
 
-    Parcel* data;
+static int compare_int(const void* int1, const void* int2) {
 
-    if ((data = (Parcel*)malloc(sizeof(Parcel))) == NULL)                       // Allocate storage for the parcel. 
+    if (*(const int*)int1 > * (const int*)int2)
+        return 1;
+    else if (*(const int*)int1 < *(const int*)int2)
         return -1;
+    else
+        return 0;
+}
 
-    memcpy(data, parcel, sizeof(Parcel));
+#if PQUEUE_BACKEND == PQUEUE_HEAP                                                   // The demo queue below holds int pointers.
 
-    if (pqueue_insert(parcels, data) != 0)                                      // Insert the parcel into the priority queue.
-        return -1;
+static void print_pqueue(PQueue* pqueue) {
 
-    return 0;
+    int i;
+
+    fprintf(stdout, "Priority queue size is %d\n", pqueue_size(pqueue));
+
+    for (i = 0; i < pqueue_size(pqueue); i++)
+        fprintf(stdout, "Node=%03d\n", *(int*)pqueue->tree[i]);
+
+    return;
 }
 
+#endif // PQUEUE_BACKEND
+
 
-////////////////
-// MAINLINE
-////////////////
 int main()
 {
     printf("Entering Heap and PQueue implementation in C...\n");
@@ -505,7 +2398,7 @@ int main()
 
 
     struct Queue* q = (struct Queue*)malloc(sizeof(struct Queue));;
-    q->front = q->rear = NULL;
+    initQueue(q);
 
     // Inserting elements in Circular Queue 
     printf("enqueing 14, 22, 6 into circ. q\n");
@@ -533,7 +2426,11 @@ int main()
     printf("\nDeleted value = %d", deQueue(q));
     printf("\n------------------------------------------------------\n");
 
+    destroyQueue(q);
+    free(q);
 
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
     ////////////////////////
     // Priority Queue Usage
     ////////////////////////
@@ -613,12 +2510,15 @@ int main()
     
     fprintf(stdout, "Destroying the pqueue\n");
     pqueue_destroy(&pqueue);                                                                // Clean up priority queue
+#endif // PQUEUE_BACKEND
     
     return 0;
     
 
 } // END_MAINLINE
 
+#endif // HEAP_PQUEUE_NO_MAIN
+
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
 // Debug program: F5 or Debug > Start Debugging menu
     ///////
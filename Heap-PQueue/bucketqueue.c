@@ -0,0 +1,287 @@
+// bucketqueue.c : O(1) bucket queue backend for priorities 0 .. 255.
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "bucketqueue.h"
+#include "latency.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the bucket queue.
+////////////////////////////////////////////////////////////
+
+#define bucket_item(ring, esize, npos) ((ring)->items + (size_t)((npos) & ((ring)->capacity - 1)) * (esize))
+
+// Priority of item, or -1 when it is out of range.
+static int bucket_key(const BucketQueue* queue, const void* item) {
+
+    long long key = queue->keytype == HEAP_KEY_I64 ? *(const long long*)item : *(const int*)item;
+
+    return key >= 0 && key < BUCKET_PRIORITIES ? (int)key : -1;
+}
+
+static int bucket_clz(unsigned long long x) {                                       // Leading zeros of a non-zero word.
+
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    _BitScanReverse64(&index, x);
+    return 63 - (int)index;
+#else
+    if (_BitScanReverse(&index, (unsigned long)(x >> 32)))
+        return 31 - (int)index;
+    _BitScanReverse(&index, (unsigned long)x);
+    return 63 - (int)index;
+#endif
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+// Highest non-empty priority; the queue is not empty.
+static int bucket_top(const BucketQueue* queue) {
+
+    int w;
+
+    for (w = BUCKET_WORDS - 1; queue->map[w] == 0; w--)
+        ;
+
+    return w * 64 + 63 - bucket_clz(queue->map[w]);
+}
+
+// Resize ring to capacity slots (a power of two >= size), unwrapping it to start at 0.
+static int bucket_resize(BucketRing* ring, int esize, int capacity) {
+
+    char* items;
+    int first;
+
+    if (capacity == 0) {
+        free(ring->items);
+        ring->items = NULL;
+        ring->head = 0;
+        ring->capacity = 0;
+        return 0;
+    }
+
+    if ((items = (char*)malloc((size_t)capacity * esize)) == NULL)
+        return -1;
+
+    if (ring->size > 0) {
+
+        first = ring->capacity - ring->head < ring->size ? ring->capacity - ring->head : ring->size;
+        memcpy(items, bucket_item(ring, esize, ring->head), (size_t)first * esize);
+        memcpy(items + (size_t)first * esize, ring->items, (size_t)(ring->size - first) * esize);
+    }
+
+    free(ring->items);
+    ring->items = items;
+    ring->head = 0;
+    ring->capacity = capacity;
+
+    return 0;
+}
+
+////////////////////////////////////////
+// Public interface: Bucket Queue API
+////////////////////////////////////////
+// void  bucket_init_keyed(BucketQueue* queue, int esize, int keytype)
+// void  bucket_destroy(BucketQueue* queue)
+// int   bucket_insert(BucketQueue* queue, const void* data)
+// int   bucket_extract(BucketQueue* queue, void** data)
+// void* bucket_peek(BucketQueue* queue)
+// int   bucket_insert_many(BucketQueue* queue, void** items, int n)
+// int   bucket_extract_k(BucketQueue* queue, void** data, int k)
+// int   bucket_shrink_to_fit(BucketQueue* queue)
+// int   bucket_merge(BucketQueue* dst, BucketQueue* src)
+////////////////////////////////////////
+
+void bucket_init_keyed(BucketQueue* queue, int esize, int keytype) {
+
+    memset(queue, 0, sizeof(BucketQueue));
+
+    queue->esize = esize;
+    queue->keytype = keytype;
+
+    return;
+}
+
+void bucket_destroy(BucketQueue* queue) {
+
+    int p;
+
+    for (p = 0; p < BUCKET_PRIORITIES; p++)
+        free(queue->ring[p].items);
+
+    memset(queue, 0, sizeof(BucketQueue));                                          // Clear the structure to be on the safe side.
+
+    return;
+}
+
+int bucket_insert(BucketQueue* queue, const void* data) {
+
+    BucketRing* ring;
+    unsigned long long t0 = latency_begin();
+    int p;
+
+    if ((p = bucket_key(queue, data)) < 0)
+        return -1;
+
+    ring = &queue->ring[p];
+
+    if (ring->size == ring->capacity
+        && bucket_resize(ring, queue->esize, ring->capacity == 0 ? HEAP_MIN_CAPACITY : ring->capacity * 2) != 0)
+        return -1;
+
+    memcpy(bucket_item(ring, queue->esize, ring->head + ring->size), data, queue->esize);   // Append at the tail.
+    ring->size++;
+
+    queue->map[p / 64] |= 1ULL << (p % 64);
+    queue->size++;
+    latency_end(LAT_PQUEUE_INSERT, t0);
+
+    return 0;
+}
+
+int bucket_extract(BucketQueue* queue, void** data) {
+
+    BucketRing* ring;
+    unsigned long long t0 = latency_begin();
+    int p;
+
+    if (queue->size == 0)
+        return -1;
+
+    p = bucket_top(queue);
+    ring = &queue->ring[p];
+
+    memcpy(data, bucket_item(ring, queue->esize, ring->head), queue->esize);        // Pop the oldest element of the top ring.
+    ring->head = (ring->head + 1) & (ring->capacity - 1);
+
+    if (--ring->size == 0) {
+        ring->head = 0;
+        queue->map[p / 64] &= ~(1ULL << (p % 64));
+    }
+
+    queue->size--;
+    latency_end(LAT_PQUEUE_EXTRACT, t0);
+
+    return 0;
+}
+
+void* bucket_peek(BucketQueue* queue) {
+
+    BucketRing* ring;
+
+    if (queue->size == 0)
+        return NULL;
+
+    ring = &queue->ring[bucket_top(queue)];
+
+    return bucket_item(ring, queue->esize, ring->head);
+}
+
+int bucket_insert_many(BucketQueue* queue, void** items, int n) {
+
+    int i;
+
+    if (n < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {                                                       // Appends are already O(1); no heapify to batch.
+
+        if (bucket_insert(queue, (char*)items + (size_t)i * queue->esize) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int bucket_extract_k(BucketQueue* queue, void** data, int k) {
+
+    int i;
+
+    for (i = 0; i < k && bucket_extract(queue, (void**)((char*)data + (size_t)i * queue->esize)) == 0; i++)
+        ;
+
+    return i;
+}
+
+int bucket_shrink_to_fit(BucketQueue* queue) {
+
+    BucketRing* ring;
+    int capacity;
+    int p;
+
+    for (p = 0; p < BUCKET_PRIORITIES; p++) {                                       // Smallest power of two that holds each ring.
+
+        ring = &queue->ring[p];
+        for (capacity = ring->size == 0 ? 0 : 1; capacity < ring->size; capacity *= 2)
+            ;
+
+        if (capacity < ring->capacity && bucket_resize(ring, queue->esize, capacity) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int bucket_merge(BucketQueue* dst, BucketQueue* src) {
+
+    BucketRing* to;
+    BucketRing* from;
+    BucketRing swap;
+    int capacity;
+    int p, w, i;
+
+    if (dst == src || dst->esize != src->esize || dst->keytype != src->keytype)
+        return -1;
+
+    for (p = 0; p < BUCKET_PRIORITIES; p++) {                                       // Grow every ring that takes elements first,
+                                                                                    // so the moves below cannot fail half way.
+        to = &dst->ring[p];
+        from = &src->ring[p];
+        if (to->size == 0 || from->size == 0)
+            continue;
+
+        for (capacity = to->capacity; capacity < to->size + from->size; capacity *= 2)
+            ;
+        if (capacity > to->capacity && bucket_resize(to, dst->esize, capacity) != 0)
+            return -1;
+    }
+
+    for (p = 0; p < BUCKET_PRIORITIES; p++) {
+
+        to = &dst->ring[p];
+        from = &src->ring[p];
+        if (from->size == 0)
+            continue;
+
+        if (to->size == 0) {                                                        // Hand the whole ring over.
+            memcpy(&swap, to, sizeof(BucketRing));
+            memcpy(to, from, sizeof(BucketRing));
+            memcpy(from, &swap, sizeof(BucketRing));
+        }
+        else {                                                                      // Oldest first, behind dst's newest.
+            for (i = 0; i < from->size; i++)
+                memcpy(bucket_item(to, dst->esize, to->head + to->size + i), bucket_item(from, src->esize, from->head + i), dst->esize);
+            to->size += from->size;
+        }
+
+        bucket_resize(from, src->esize, 0);
+        from->size = 0;
+    }
+
+    for (w = 0; w < BUCKET_WORDS; w++) {
+        dst->map[w] |= src->map[w];
+        src->map[w] = 0;
+    }
+
+    dst->size += src->size;
+    src->size = 0;
+
+    return 0;
+}
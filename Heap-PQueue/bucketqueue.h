@@ -0,0 +1,76 @@
+// bucketqueue.h - bucket queue for small bounded priorities
+/////////////////////////////////////////////////////////////
+#ifndef BUCKETQUEUE_H
+#define BUCKETQUEUE_H
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// A bucket queue keeps one FIFO ring of by-value elements per priority 0 .. 255 and a
+// 256-bit map of the non-empty rings. Insert appends to ring[priority]; extract finds
+// the highest set bit with count-leading-zeros over at most four words and pops the
+// ring's head. Both are O(1), and elements of equal priority leave in arrival order.
+//
+// The priority is the key at offset 0 of each esize-byte element (HEAP_KEY_I32 or
+// HEAP_KEY_I64, as with heap_init_keyed); keys outside 0 .. 255 are rejected with -1.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define BUCKET_PRIORITIES 256
+
+#define BUCKET_WORDS (BUCKET_PRIORITIES / 64)
+
+typedef struct BucketRing_ {
+
+	int head;                                                  // slot of the oldest element
+	int size;
+	int capacity;                                              // 0 or a power of two
+
+	char* items;
+
+} BucketRing;
+
+typedef struct BucketQueue_ {
+
+	int size;
+	int esize;
+	int keytype;                                               // HEAP_KEY_I32 or HEAP_KEY_I64
+
+	unsigned long long map[BUCKET_WORDS];                      // bit p set when ring[p] is non-empty
+
+	BucketRing ring[BUCKET_PRIORITIES];
+
+} BucketQueue;
+
+////////////////////////////////////////
+// Public interface: Bucket Queue API
+////////////////////////////////////////
+
+void bucket_init_keyed(BucketQueue* queue, int esize, int keytype);
+
+void bucket_destroy(BucketQueue* queue);
+
+// Returns -1 when data's priority is outside 0 .. BUCKET_PRIORITIES - 1.
+int bucket_insert(BucketQueue* queue, const void* data);
+
+// data is the address of a caller buffer of esize bytes, as with heap_extract.
+int bucket_extract(BucketQueue* queue, void** data);
+
+// The next element bucket_extract will return, or NULL.
+void* bucket_peek(BucketQueue* queue);
+
+// Bulk forms with the heap_insert_many / heap_extract_k layouts and return codes.
+int bucket_insert_many(BucketQueue* queue, void** items, int n);
+
+int bucket_extract_k(BucketQueue* queue, void** data, int k);
+
+int bucket_shrink_to_fit(BucketQueue* queue);
+
+// Move every element of src into dst, leaving src empty. Each of src's rings is queued
+// behind dst's ring of the same priority, so FIFO order within a queue is kept; a ring
+// dst does not use is simply handed over. Returns -1, changing neither, if the layouts
+// differ or memory runs out.
+int bucket_merge(BucketQueue* dst, BucketQueue* src);
+
+#define bucket_size(queue) ((queue)->size)
+
+#endif
@@ -3,6 +3,8 @@
 #ifndef CQUEUE_H
 #define CQUEUE_H
 
+#include "heap.h"
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 // Circular Queue - Data Struct
 ///////////////////////////////
@@ -10,34 +12,57 @@
 //    <------   queue   <------  enque(val)/push_back()
 //<--getfront()   x delqueue
 //   dequeue()
-// front rear
-//    f  r           f    r              f            r
-//    |  |           |    |              |            |
-//    v  v           v    v              v            v
-//   -> 14 -      -> 14 -> 22 -         ->14 -> 22 -> -6-
-//  | ---- |     |-------------|       | ----------------|
-//  enqueue(14)       enqueue(22)         enqueue(-6)
-// 
-// 
-//                                     dequeue()/pop() (14) => like middle drawing
+//
+//   items:  [ 22 | -6 |    |    |    |    |    | 14 ]     capacity 8 (a power of two)
+//                       ^                        ^
+//                       rear & 7                 front & 7
+//
+// front and rear count every deQueue / enQueue since the last growth and are masked
+// with capacity - 1 to index items, so size is rear - front and wrapping is free.
+// A full ring doubles and is unwrapped into the new block, which comes from the
+// queue's HeapAllocator when it was set up with initQueue_alloc. With a Pool's
+// allocator only rings up to the pool's osize come from its slabs; larger rings
+// fall back to malloc through the same hook. shrinkQueue moves
+// the values into the smallest ring that holds them, or frees an empty ring.
 ///////////////////////////////////////////////////////////////////////////////////////////
 // circular queue data structure
 /////////////////////////////////
-struct Node {
-    int data;
-    struct Node* next;
-};
+// Counters kept by a HEAP_STATS build (see heap.h) since initQueue.
+typedef struct QueueStats_ {
+    long long enqueues;
+    long long dequeues;
+    long long allocs;           // ring blocks allocated
+    int peak;                   // most values queued at once
+    int size;                   // at the snapshot
+    int capacity;               // at the snapshot
+} QueueStats;
 
 struct Queue {
-    struct Node* front;
-    struct Node* rear;
+    int* items;
+    int capacity;               // 0 or a power of two
+    unsigned int front;         // position of the oldest value
+    unsigned int rear;          // position after the newest value
+    const HeapAllocator* alloc; // source of items, or NULL for malloc
+#if HEAP_STATS
+    QueueStats stats;
+#endif
 };
 /////////////////////////////////////////
 // Public interface: Circular Queue API
 /////////////////////////////////////////
 
-void enQueue(struct Queue* q, int value);
+void initQueue(struct Queue* q);
+void initQueue_alloc(struct Queue* q, const HeapAllocator* alloc);
+void destroyQueue(struct Queue* q);
+int enQueue(struct Queue* q, int value);
 int deQueue(struct Queue* q);
+int enQueue_n(struct Queue* q, const int* values, int n);        // 0, or -1 with nothing queued
+int deQueue_n(struct Queue* q, int* values, int max);            // number of values dequeued
+int shrinkQueue(struct Queue* q);                                 // give back ring space beyond what the values need; empty frees it
 void displayQueue(struct Queue* q);
+int statsQueue(struct Queue* q, QueueStats* stats);               // 0, or -1 when built without HEAP_STATS
+void dumpStatsQueue(struct Queue* q, const char* name);
+
+#define queueSize(q) ((int)((q)->rear - (q)->front))
 
 #endif
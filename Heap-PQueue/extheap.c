@@ -0,0 +1,443 @@
+// extheap.c : external-memory priority queue backend with mapped sorted runs.
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "extheap.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the external heap.
+////////////////////////////////////////////////////////////
+
+#define extheap_item(heap, run, npos) ((run)->items + (size_t)(npos) * (heap)->esize)
+
+#define extheap_head(heap, run) extheap_item((heap), (run), (run)->next)
+
+static long long extheap_key(const ExtHeap* heap, const void* item) {
+
+    return heap->keytype == HEAP_KEY_I64 ? *(const long long*)item : *(const int*)item;
+}
+
+static int extheap_compare_i32(const void* item1, const void* item2) {              // qsort order: highest first.
+
+    int key1 = *(const int*)item1, key2 = *(const int*)item2;
+
+    return (key1 < key2) - (key1 > key2);
+}
+
+static int extheap_compare_i64(const void* item1, const void* item2) {
+
+    long long key1 = *(const long long*)item1, key2 = *(const long long*)item2;
+
+    return (key1 < key2) - (key1 > key2);
+}
+
+// Create a temporary file of size elements and map it into run. The file is gone as
+// soon as it is unmapped (or the process exits).
+static int extheap_map(ExtHeap* heap, ExtRun* run, long long size) {
+
+    long long bytes = size * heap->esize;
+#ifdef _WIN32
+    char dir[MAX_PATH], path[MAX_PATH];
+
+    memset(run, 0, sizeof(ExtRun));
+
+    if (heap->dir[0] != '\0')
+        strcpy(dir, heap->dir);
+    else if (GetTempPathA(MAX_PATH, dir) == 0)
+        return -1;
+
+    if (GetTempFileNameA(dir, "ehp", 0, path) == 0)
+        return -1;
+
+    run->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (run->file == INVALID_HANDLE_VALUE) {
+        DeleteFileA(path);
+        return -1;
+    }
+
+    run->map = CreateFileMappingA(run->file, NULL, PAGE_READWRITE, (DWORD)(bytes >> 32), (DWORD)bytes, NULL);
+    if (run->map == NULL || (run->items = (char*)MapViewOfFile(run->map, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)bytes)) == NULL) {
+        if (run->map != NULL)
+            CloseHandle(run->map);
+        CloseHandle(run->file);
+        return -1;
+    }
+#else
+    char path[sizeof(heap->dir) + 32];
+    const char* dir = heap->dir;
+    void* items;
+    int fd;
+
+    memset(run, 0, sizeof(ExtRun));
+
+    if (dir[0] == '\0' && ((dir = getenv("TMPDIR")) == NULL || dir[0] == '\0'))
+        dir = "/tmp";
+    snprintf(path, sizeof(path), "%s/extheap-XXXXXX", dir);
+
+    if ((fd = mkstemp(path)) < 0)
+        return -1;
+    unlink(path);                                                                   // Nameless from here on: closing frees the blocks.
+
+    if (posix_fallocate(fd, 0, (off_t)bytes) != 0) {                                // Reserve the blocks so a full disk fails here,
+        close(fd);                                                                  // not as a SIGBUS while writing the map.
+        return -1;
+    }
+
+    items = mmap(NULL, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (items == MAP_FAILED)
+        return -1;
+
+    madvise(items, (size_t)bytes, MADV_SEQUENTIAL);                                 // Runs are written and read front to back.
+    run->items = (char*)items;
+#endif
+
+    run->size = size;
+    run->next = 0;
+
+    return 0;
+}
+
+static void extheap_unmap(ExtHeap* heap, ExtRun* run) {
+
+#ifdef _WIN32
+    UnmapViewOfFile(run->items);
+    CloseHandle(run->map);
+    CloseHandle(run->file);
+#else
+    munmap(run->items, (size_t)(run->size * heap->esize));
+#endif
+    memset(run, 0, sizeof(ExtRun));
+}
+
+// Drop run r once it is used up; the last run takes its place.
+static void extheap_close(ExtHeap* heap, int r) {
+
+    extheap_unmap(heap, &heap->run[r]);
+
+    if (r != --heap->nruns)
+        memcpy(&heap->run[r], &heap->run[heap->nruns], sizeof(ExtRun));
+}
+
+// Where the highest element is: -1 for the top, else a run. The heap is not empty.
+static int extheap_best(const ExtHeap* heap) {
+
+    long long key, best = 0;
+    int found = -2;
+    int r;
+
+    if (heap->top.size > 0) {
+        best = extheap_key(heap, heap_elem(&heap->top, 0));
+        found = -1;
+    }
+
+    for (r = 0; r < heap->nruns; r++) {
+
+        key = extheap_key(heap, extheap_head(heap, &heap->run[r]));
+        if (found == -2 || key > best) {
+            best = key;
+            found = r;
+        }
+    }
+
+    return found;
+}
+
+#define extheap_left(run) ((run)->size - (run)->next)
+
+// Merge the count shortest runs into one. Always merging the shortest keeps the run
+// lengths roughly geometric, so an element is rewritten O(log(size / limit)) times
+// rather than once per merge.
+static int extheap_merge_runs(ExtHeap* heap, int count) {
+
+    ExtRun merged, swap;
+    ExtRun* tail;
+    long long total = 0, key, best;
+    long long i;
+    int first = heap->nruns - count;
+    int r, pick;
+
+    for (i = 0; i < count; i++) {                                                   // Move the count shortest to the end.
+
+        pick = 0;
+        for (r = 1; r < heap->nruns - i; r++)
+            if (extheap_left(&heap->run[r]) < extheap_left(&heap->run[pick]))
+                pick = r;
+
+        memcpy(&swap, &heap->run[pick], sizeof(ExtRun));
+        memcpy(&heap->run[pick], &heap->run[heap->nruns - 1 - i], sizeof(ExtRun));
+        memcpy(&heap->run[heap->nruns - 1 - i], &swap, sizeof(ExtRun));
+    }
+
+    tail = &heap->run[first];
+    for (r = 0; r < count; r++)
+        total += extheap_left(&tail[r]);
+
+    if (extheap_map(heap, &merged, total) != 0)
+        return -1;
+
+    for (i = 0; i < total; i++) {                                                   // K-way merge over the heads left.
+
+        pick = -1;
+        best = 0;
+        for (r = 0; r < count; r++) {
+            if (extheap_left(&tail[r]) == 0)
+                continue;
+            key = extheap_key(heap, extheap_head(heap, &tail[r]));
+            if (pick < 0 || key > best) {
+                best = key;
+                pick = r;
+            }
+        }
+
+        memcpy(extheap_item(heap, &merged, i), extheap_head(heap, &tail[pick]), heap->esize);
+        tail[pick].next++;
+    }
+
+    for (r = 0; r < count; r++)
+        extheap_unmap(heap, &tail[r]);
+
+    memcpy(tail, &merged, sizeof(ExtRun));
+    heap->nruns = first + 1;
+    heap->merges++;
+    heap->spills++;
+
+    return 0;
+}
+
+// Move the lower half of a full top to a new run. Sorting the top highest first leaves
+// it a valid heap of any arity (every parent sits before its children), so the upper
+// half stays in place as the new top without a rebuild.
+static int extheap_spill(ExtHeap* heap) {
+
+    ExtRun* run;
+    int keep = heap->limit / 2;
+    int count = heap->top.size - keep;
+
+    if (heap->nruns == EXTHEAP_MAX_RUNS && extheap_merge_runs(heap, EXTHEAP_MAX_RUNS / 2) != 0)
+        return -1;
+
+    run = &heap->run[heap->nruns];
+    if (extheap_map(heap, run, count) != 0)
+        return -1;
+
+    qsort(heap->top.tree, heap->top.size, heap->esize,
+        heap->keytype == HEAP_KEY_I64 ? extheap_compare_i64 : extheap_compare_i32);
+
+    memcpy(run->items, heap_elem(&heap->top, keep), (size_t)count * heap->esize);
+    heap->top.size = keep;
+    heap->nruns++;
+    heap->spills++;
+
+    return 0;
+}
+
+////////////////////////////////////////////
+// Public interface: External Heap API
+////////////////////////////////////////////
+// void  extheap_init_keyed(ExtHeap* heap, int esize, int keytype)
+// int   extheap_set_limit(ExtHeap* heap, int limit)
+// int   extheap_set_dir(ExtHeap* heap, const char* dir)
+// void  extheap_destroy(ExtHeap* heap)
+// int   extheap_insert(ExtHeap* heap, const void* data)
+// int   extheap_extract(ExtHeap* heap, void** data)
+// void* extheap_peek(ExtHeap* heap)
+// int   extheap_insert_many(ExtHeap* heap, void** items, int n)
+// int   extheap_extract_k(ExtHeap* heap, void** data, int k)
+// int   extheap_shrink_to_fit(ExtHeap* heap)
+// long long extheap_spilled(ExtHeap* heap)
+// int   extheap_merge(ExtHeap* dst, ExtHeap* src)
+////////////////////////////////////////////
+
+void extheap_init_keyed(ExtHeap* heap, int esize, int keytype) {
+
+    memset(heap, 0, sizeof(ExtHeap));
+
+    heap->esize = esize;
+    heap->keytype = keytype;
+    heap->limit = EXTHEAP_LIMIT;
+    heap_init_keyed(&heap->top, esize, keytype);
+
+    return;
+}
+
+int extheap_set_limit(ExtHeap* heap, int limit) {
+
+    if (heap->size != 0 || limit < EXTHEAP_MIN_LIMIT)
+        return -1;
+
+    heap->limit = limit;
+
+    return 0;
+}
+
+int extheap_set_dir(ExtHeap* heap, const char* dir) {
+
+    if (heap->size != 0 || strlen(dir) >= sizeof(heap->dir))
+        return -1;
+
+    strcpy(heap->dir, dir);
+
+    return 0;
+}
+
+void extheap_destroy(ExtHeap* heap) {
+
+    while (heap->nruns > 0)
+        extheap_close(heap, heap->nruns - 1);
+
+    heap_destroy(&heap->top);
+
+    memset(heap, 0, sizeof(ExtHeap));                                               // Clear the structure to be on the safe side.
+
+    return;
+}
+
+int extheap_insert(ExtHeap* heap, const void* data) {
+
+    if (heap->top.size >= heap->limit && extheap_spill(heap) != 0)
+        return -1;
+
+    if (heap_insert(&heap->top, data) != 0)
+        return -1;
+
+    heap->size++;
+
+    return 0;
+}
+
+int extheap_extract(ExtHeap* heap, void** data) {
+
+    ExtRun* run;
+    int r;
+
+    if (heap->size == 0)
+        return -1;
+
+    if ((r = extheap_best(heap)) < 0) {
+        if (heap_extract(&heap->top, data) != 0)
+            return -1;
+    }
+    else {                                                                          // Lazy merge: take the run's head as it is.
+        run = &heap->run[r];
+        memcpy(data, extheap_head(heap, run), heap->esize);
+        if (++run->next == run->size)
+            extheap_close(heap, r);
+    }
+
+    heap->size--;
+
+    return 0;
+}
+
+void* extheap_peek(ExtHeap* heap) {
+
+    int r;
+
+    if (heap->size == 0)
+        return NULL;
+
+    if ((r = extheap_best(heap)) < 0)
+        return heap_elem(&heap->top, 0);
+
+    return extheap_head(heap, &heap->run[r]);
+}
+
+int extheap_insert_many(ExtHeap* heap, void** items, int n) {
+
+    int room, count, i;
+
+    if (n < 0)
+        return -1;
+
+    for (i = 0; i < n; i += count) {                                                // Batches that fit the top go in with one
+                                                                                    // heap_insert_many; a full top spills first.
+        if (heap->top.size >= heap->limit && extheap_spill(heap) != 0)
+            return -1;
+
+        room = heap->limit - heap->top.size;
+        count = n - i < room ? n - i : room;
+        if (heap_insert_many(&heap->top, (void**)((char*)items + (size_t)i * heap->esize), count) != 0)
+            return -1;
+        heap->size += count;
+    }
+
+    return 0;
+}
+
+int extheap_extract_k(ExtHeap* heap, void** data, int k) {
+
+    int i;
+
+    for (i = 0; i < k && extheap_extract(heap, (void**)((char*)data + (size_t)i * heap->esize)) == 0; i++)
+        ;
+
+    return i;
+}
+
+int extheap_shrink_to_fit(ExtHeap* heap) {
+
+    return heap_shrink_to_fit(&heap->top);
+}
+
+long long extheap_spilled(ExtHeap* heap) {
+
+    long long spilled = 0;
+    int r;
+
+    for (r = 0; r < heap->nruns; r++)
+        spilled += heap->run[r].size - heap->run[r].next;
+
+    return spilled;
+}
+
+int extheap_merge(ExtHeap* dst, ExtHeap* src) {
+
+    ExtRun* run;
+    int room, count;
+
+    if (dst == src || dst->esize != src->esize || dst->keytype != src->keytype)
+        return -1;
+
+    while (src->nruns > 0) {                                                        // Runs move without being read.
+
+        if (dst->nruns == EXTHEAP_MAX_RUNS && extheap_merge_runs(dst, EXTHEAP_MAX_RUNS / 2) != 0)
+            return -1;
+
+        run = &src->run[--src->nruns];
+        memcpy(&dst->run[dst->nruns++], run, sizeof(ExtRun));
+        dst->size += extheap_left(run);
+        src->size -= extheap_left(run);
+        memset(run, 0, sizeof(ExtRun));
+    }
+
+    while (src->top.size > 0) {                                                     // The top's tail goes over a batch at a time;
+                                                                                    // a heap minus its last slots is still a heap.
+        if (dst->top.size >= dst->limit && extheap_spill(dst) != 0)
+            return -1;
+
+        room = dst->limit - dst->top.size;
+        count = src->top.size < room ? src->top.size : room;
+        if (heap_insert_many(&dst->top, (void**)heap_elem(&src->top, src->top.size - count), count) != 0)
+            return -1;
+
+        src->top.size -= count;
+        dst->size += count;
+        src->size -= count;
+    }
+
+    heap_shrink_to_fit(&src->top);
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+// extheap.h - external-memory priority queue spilling to mapped files
+///////////////////////////////////////////////////////////////////////
+#ifndef EXTHEAP_H
+#define EXTHEAP_H
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// An external heap keeps at most limit by-value elements in an ordinary keyed Heap (the
+// top) and the rest on disk. When an insert finds the top full, the top is sorted
+// highest first - a sorted array is still a valid heap - and its lower half is written
+// to a temporary file as a sorted run, so memory stays bounded however long the queue
+// grows. Runs are memory mapped: the OS pages them in and out as needed, and the kernel
+// rather than the process decides what stays resident.
+//
+// Runs are merged lazily: extract compares the top's root with the next element of
+// every run and takes the highest, reading each run front to back. Once EXTHEAP_MAX_RUNS
+// runs exist, the next spill first merges the shorter half of them into one, so an
+// extract never looks at more than EXTHEAP_MAX_RUNS + 1 candidates.
+//
+// The key sits at offset 0 of each esize-byte element (HEAP_KEY_I32 or HEAP_KEY_I64,
+// largest first), as with heap_init_keyed. Run files are deleted when they are closed,
+// or by the OS if the process dies.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define EXTHEAP_LIMIT    (1 << 20)                             // default elements kept in memory
+#define EXTHEAP_MIN_LIMIT 16
+#define EXTHEAP_MAX_RUNS 16
+
+typedef struct ExtRun_ {
+
+	char* items;                                               // mapped file of size elements, highest first
+	long long size;
+	long long next;                                            // first element not yet extracted
+
+#ifdef _WIN32
+	void* file;                                                // HANDLE of the file and of its mapping
+	void* map;
+#endif
+
+} ExtRun;
+
+typedef struct ExtHeap_ {
+
+	long long size;                                            // elements in top and runs
+	int esize;
+	int keytype;                                               // HEAP_KEY_I32 or HEAP_KEY_I64
+	int limit;                                                 // most elements kept in top
+
+	Heap top;                                                  // the highest elements inserted since the last spill
+
+	int nruns;
+	ExtRun run[EXTHEAP_MAX_RUNS];
+
+	long long spills;                                          // runs written, including merged ones
+	long long merges;
+
+	char dir[260];                                             // where run files go; "" = the system temp directory
+
+} ExtHeap;
+
+////////////////////////////////////////////
+// Public interface: External Heap API
+////////////////////////////////////////////
+
+void extheap_init_keyed(ExtHeap* heap, int esize, int keytype);
+
+// Keep at most limit (>= EXTHEAP_MIN_LIMIT) elements in memory. Only while empty.
+int extheap_set_limit(ExtHeap* heap, int limit);
+
+// Put run files in dir instead of the system temp directory. Only while empty.
+int extheap_set_dir(ExtHeap* heap, const char* dir);
+
+void extheap_destroy(ExtHeap* heap);
+
+// Returns -1 if a spill is needed and the run file cannot be created or written.
+int extheap_insert(ExtHeap* heap, const void* data);
+
+// data is the address of a caller buffer of esize bytes, as with heap_extract.
+int extheap_extract(ExtHeap* heap, void** data);
+
+// The next element extheap_extract will return, or NULL.
+void* extheap_peek(ExtHeap* heap);
+
+// Bulk forms with the heap_insert_many / heap_extract_k layouts and return codes.
+int extheap_insert_many(ExtHeap* heap, void** items, int n);
+
+int extheap_extract_k(ExtHeap* heap, void** data, int k);
+
+int extheap_shrink_to_fit(ExtHeap* heap);
+
+#define extheap_size(heap) ((heap)->size)
+
+// Elements currently on disk.
+long long extheap_spilled(ExtHeap* heap);
+
+// Move every element of src into dst, leaving src empty. src's runs change owner as
+// they are, files and all; only its in-memory top is copied, into dst's top, spilling
+// as usual. Returns -1 if the layouts differ, or if a spill or run merge in dst fails.
+// Elements already moved then stay in dst and the rest in src, so none is lost.
+int extheap_merge(ExtHeap* dst, ExtHeap* src);
+
+#endif
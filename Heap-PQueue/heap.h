@@ -3,18 +3,78 @@
 #ifndef HEAP_H
 #define HEAP_H
 
+#include <stddef.h>
+
 // heap data structure
 ///////////////////////
 
+#define HEAP_MIN_CAPACITY 16                                   // smallest tree allocation; below this the heap never shrinks
+
+#define HEAP_CACHE_LINE 64                                     // tree alignment; sibling groups are packed into one line
+
+#ifndef HEAP_STATS
+#define HEAP_STATS 0                                           // build with /DHEAP_STATS=1 to count hot-path events (heap_stats);
+#endif                                                         // every file of a program must agree, as it changes Heap / Queue
+
+#define HEAP_KEY_NONE 0                                        // order by compare
+#define HEAP_KEY_I32  1                                        // order by the int at offset 0 of each element, largest first
+#define HEAP_KEY_I64  2                                        // order by the long long at offset 0 of each element, largest first
+
+// Allocator for the objects a queue holds, e.g. a Pool (pool.h) behind pool_allocator.
+typedef struct HeapAllocator_ {
+
+	void* (*alloc)(void* ctx, size_t size);                    // NULL on failure
+	void (*free)(void* ctx, void* ptr);
+	void* ctx;
+
+} HeapAllocator;
+
+// Counters kept by a HEAP_STATS build since init or the last heap_stats_reset.
+typedef struct HeapStats_ {
+
+	long long inserts;                                         // nodes added: insert, insert_many, build
+	long long extracts;                                        // nodes taken out: extract, extract_k, remove
+	long long compares;                                        // key comparisons; a SIMD group select counts arity - 1
+	long long moves;                                           // slot writes: sifts move a hole, one write per level, no swaps
+	long long sift_levels;                                     // levels walked by all sifts
+	long long sift_max;                                        // most levels walked by a single sift
+	long long reallocs;                                        // tree allocations, growing or shrinking
+	int peak_size;
+	int size;                                                  // at the snapshot
+	int capacity;                                              // at the snapshot
+
+} HeapStats;
+
 typedef struct Heap_ {
 
 	int size;
+	int capacity;                                              // slots allocated in tree; grows x2 when full, halves at 1/4 full
+	int esize;                                                 // bytes per element stored inline in tree; 0 = tree holds pointers
+	int dshift;                                                // log2 of the arity: 1 = binary, 2 = 4-ary, 3 = 8-ary, 4 = 16-ary
+	int keytype;                                               // HEAP_KEY_*: integer keys are compared inline, not through compare
 
 	int (*compare)(const void* key1, const void* key2);
 	void (*destroy)(void* data);
+	const HeapAllocator* alloc;                                // where pointer-mode elements come from, or NULL for malloc
+	int (*select)(const void* keys);                           // SIMD best-child kernel for full sibling groups, or NULL
 
 	void** tree;
 
+	int* ids;                                                  // handle of the node in each slot, or NULL without handles
+	int* pos;                                                  // slot of each live handle; free handles chain through negative values
+	int nhandles;                                              // handles allocated in pos
+	int freeh;                                                 // first free handle, -1 if none
+
+	unsigned int seq;                                          // insertion counter for stable (FIFO-on-ties) keys
+
+	void* map;                                                 // snapshot mapping tree lives in after heap_load, else NULL
+	size_t map_bytes;
+
+#if HEAP_STATS
+	HeapStats stats;
+	long long sift_mark;                                       // sift_levels when the current sift began
+#endif
+
 } Heap;
 
 ////////////////////////////////
@@ -24,13 +84,138 @@ typedef struct Heap_ {
 void heap_init(Heap* heap, int (*compare)(const void* key1, const void* key2),
 	void (*destroy)(void* data));
 
+// Pointer heap whose elements were allocated through alloc; heap_destroy hands any
+// left over back to alloc->free.
+void heap_init_alloc(Heap* heap, int (*compare)(const void* key1, const void* key2),
+	const HeapAllocator* alloc);
+
+void heap_init_sized(Heap* heap, int esize, int (*compare)(const void* key1, const void* key2));
+
+// By-value heap of esize-byte elements ordered by a signed integer key at offset 0
+// (keytype HEAP_KEY_I32 or HEAP_KEY_I64; esize must be a multiple of the key width).
+// When esize equals the key width and the arity is 4..16, sift-down picks the best
+// child with an SSE4.1/AVX2 kernel chosen at run time (see heapsimd.h).
+void heap_init_keyed(Heap* heap, int esize, int keytype);
+
+// Switch an empty heap to a d-ary tree, d = 2, 4, 8 or 16. Returns -1 otherwise.
+int heap_set_arity(Heap* heap, int arity);
+
 void heap_destroy(Heap* heap);
 
 int heap_insert(Heap* heap, const void* data);
 
+// For heap_init_sized heaps data is the address of a caller buffer of esize
+// bytes, e.g. heap_extract(&heap, (void**)&parcel); the element is copied there.
 int heap_extract(Heap* heap, void** data);
 
+// Add n items in O(size + n) with Floyd's bottom-up heapify. items is an array of n
+// pointers, or for heap_init_sized heaps the base of n contiguous esize-byte elements.
+int heap_build(Heap* heap, void** items, int n);
+
+// Insert n items (same layout as heap_build) with one reservation; batches at least as
+// large as the heap are heapified in O(size + n) instead of sifted up one by one.
+// Returns -1 for n < 0.
+int heap_insert_many(Heap* heap, void** items, int n);
+
+// Extract up to k top items into data (k pointers, or k esize-byte elements), highest
+// first, shrinking the tree once at the end. Returns the number extracted (0 for k < 0).
+int heap_extract_k(Heap* heap, void** data, int k);
+
+// Move every element of src into dst, leaving src empty but initialized. Both must hold
+// the same kind of element (esize, keytype and, for compare heaps, compare). src's tree
+// is appended to dst's and heapified in O(size(dst) + size(src)), or sifted up element
+// by element when that is cheaper (src smaller than size(dst) / log2 size(dst)).
+// Without handles the larger tree is kept and the smaller one merged into it. dst's
+// handles stay valid and merged nodes get new ones. src must not have handles: use
+// heap_merge_remap. Returns -1, changing neither, on a mismatch, a src with handles or
+// when memory runs out.
+int heap_merge(Heap* dst, Heap* src);
+
+// heap_merge for a src with handles, into a dst with handles (heap_enable_handles):
+// remap, of src->nhandles ints, receives for each handle of src the handle its node has
+// in dst, or -1 for handles that were free. src's handles are released.
+int heap_merge_remap(Heap* dst, Heap* src, int* remap);
+
+// heap_insert followed by heap_extract, fused: data goes in and the top comes out into
+// out (as heap_extract's data) with at most one sift-down and no realloc. When data is
+// at least as high as the root, data itself is the top: it is passed straight back in
+// O(1) and the tree is not touched. This is how a bounded "keep the best k" heap turns
+// items away. out may be data's own buffer.
+int heap_pushpop(Heap* heap, const void* data, void** out);
+
+// heap_extract followed by heap_insert, fused: the top goes to out and data takes its
+// place with one sift-down. Returns -1 on an empty heap. With handles the new node gets
+// a new handle and the old top's is released, as with the two separate calls.
+int heap_replace(Heap* heap, const void* data, void** out);
+
+int heap_reserve(Heap* heap, int capacity);
+
+int heap_shrink_to_fit(Heap* heap);
+
+// Make the heap addressable: from now on every node carries a handle, an int that
+// stays valid while the node is queued no matter how it moves. Nodes already queued
+// get handles 0 .. size-1 in slot order. Handles are recycled after extract/remove.
+int heap_enable_handles(Heap* heap);
+
+// heap_insert that also passes back the new node's handle (-1 without handles).
+int heap_insert_handle(Heap* heap, const void* data, int* handle);
+
+// Restore heap order after the caller changed the key of the node behind handle
+// (through heap_handle_elem), whether it went up or down. O(log n).
+int heap_update(Heap* heap, int handle);
+
+// Remove the node behind handle from anywhere in the heap, passing it back in data
+// as heap_extract does. O(log n).
+int heap_remove(Heap* heap, int handle, void** data);
+
+// 64-bit key ordering by priority, then by arrival: an older seq packs a larger low
+// word, so one HEAP_KEY_I64 compare keeps equal priorities first in, first out.
+#define heap_stable_key(priority, seq) \
+	((long long)((unsigned long long)(long long)(priority) << 32 | (unsigned int)~(unsigned int)(seq)))
+
+// The seq packed into a stable key.
+#define heap_stable_seq(key) (~(unsigned int)(key))
+
+// Write a by-value heap (heap_init_sized / _keyed) to path as a snapshot: a versioned
+// header, the tree exactly as it is laid out in memory and a checksum over it. The file
+// is written under a temporary name, flushed to disk and renamed into place (and the
+// directory flushed), so path always holds either the old snapshot or the complete new
+// one. A tree still mapped from heap_load is first copied to ordinary memory on Windows,
+// where a mapped file cannot be replaced. Handles are not saved.
+int heap_save(Heap* heap, const char* path);
+
+// Replace the contents of an empty heap, initialized with the same esize and keytype
+// as the saved one, by the snapshot at path. The file is mapped copy-on-write and its
+// tree adopted as it is, already in heap order: no copy, no heapify, only the checksum
+// pass. The tree moves to ordinary memory the first time it has to grow. Returns -1,
+// leaving the heap as it was, on a missing, foreign, corrupt or mismatching file.
+int heap_load(Heap* heap, const char* path);
+
+// Flush the directory holding path, so a file just created or renamed there survives
+// a power loss; fsync of the file alone does not cover its directory entry. Returns
+// -1 on failure. A no-op on Windows, where the file system journals the entry.
+int heap_dir_sync(const char* path);
+
+// Snapshot the counters into stats. Returns -1, with stats zeroed but size and
+// capacity filled in, when the build has HEAP_STATS 0.
+int heap_stats(Heap* heap, HeapStats* stats);
+
+void heap_stats_reset(Heap* heap);
+
+// Print heap_stats to stdout, with the average sift depth and compares per operation.
+void heap_stats_dump(Heap* heap, const char* name);
+
 #define heap_size(heap) ((heap)->size)
 
+#define heap_capacity(heap) ((heap)->capacity)
+
+// Address of the element at position npos, as handed to compare: the stored
+// pointer for heap_init heaps, the inline slot for heap_init_sized heaps.
+#define heap_elem(heap, npos) ((heap)->esize == 0 ? (heap)->tree[npos] \
+	: (void*)((char*)(heap)->tree + (size_t)(npos) * (heap)->esize))
+
+// Address of the element behind a live handle, as heap_elem.
+#define heap_handle_elem(heap, handle) heap_elem((heap), (heap)->pos[handle])
+
 #endif
 
@@ -0,0 +1,257 @@
+// heapsimd.c : SSE4.1 / AVX2 child-selection kernels for integer-keyed heaps.
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+
+#include "heap.h"
+#include "heapsimd.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HEAP_SIMD_X86 1
+#endif
+
+#ifdef HEAP_SIMD_X86
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the kernels.
+////////////////////////////////////////////////////////////
+
+#if defined(__GNUC__) || defined(__clang__)                                       // MSVC emits any intrinsic; GCC/Clang need the target enabled per function.
+#define HEAP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define HEAP_TARGET(isa)
+#endif
+
+static int heap_ctz(unsigned int mask) {                                          // Index of the lowest set bit; mask is never 0 here.
+
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+///////////////////////
+// int32 kernels
+///////////////////////
+
+HEAP_TARGET("sse4.1")
+static __m128i heap_max4_i32(__m128i v) {                                         // Broadcast the max of 4 lanes.
+
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+HEAP_TARGET("sse4.1")
+static int heap_select4_i32_sse41(const void* keys) {
+
+    __m128i v = _mm_loadu_si128((const __m128i*)keys);
+    __m128i m = heap_max4_i32(v);
+
+    return heap_ctz(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, m))));
+}
+
+HEAP_TARGET("sse4.1")
+static int heap_select8_i32_sse41(const void* keys) {
+
+    __m128i v0 = _mm_loadu_si128((const __m128i*)keys);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)keys + 1);
+    __m128i m = heap_max4_i32(_mm_max_epi32(v0, v1));
+
+    return heap_ctz(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v0, m)))
+        | _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v1, m))) << 4);
+}
+
+HEAP_TARGET("sse4.1")
+static int heap_select16_i32_sse41(const void* keys) {
+
+    __m128i v0 = _mm_loadu_si128((const __m128i*)keys);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)keys + 1);
+    __m128i v2 = _mm_loadu_si128((const __m128i*)keys + 2);
+    __m128i v3 = _mm_loadu_si128((const __m128i*)keys + 3);
+    __m128i m = heap_max4_i32(_mm_max_epi32(_mm_max_epi32(v0, v1), _mm_max_epi32(v2, v3)));
+
+    return heap_ctz(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v0, m)))
+        | _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v1, m))) << 4
+        | _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v2, m))) << 8
+        | _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v3, m))) << 12);
+}
+
+HEAP_TARGET("avx2")
+static __m256i heap_max8_i32(__m256i v) {                                         // Broadcast the max of 8 lanes.
+
+    v = _mm256_max_epi32(v, _mm256_permute2x128_si256(v, v, 1));
+    v = _mm256_max_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm256_max_epi32(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+HEAP_TARGET("avx2")
+static int heap_select8_i32_avx2(const void* keys) {
+
+    __m256i v = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i m = heap_max8_i32(v);
+
+    return heap_ctz(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, m))));
+}
+
+HEAP_TARGET("avx2")
+static int heap_select16_i32_avx2(const void* keys) {
+
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)keys + 1);
+    __m256i m = heap_max8_i32(_mm256_max_epi32(v0, v1));
+
+    return heap_ctz(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v0, m)))
+        | _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v1, m))) << 8);
+}
+
+///////////////////////
+// int64 kernels
+///////////////////////
+
+HEAP_TARGET("avx2")
+static __m256i heap_max_i64(__m256i a, __m256i b) {                               // AVX2 has no max_epi64; compare and blend.
+
+    return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b));
+}
+
+HEAP_TARGET("avx2")
+static __m256i heap_max4_i64(__m256i v) {                                         // Broadcast the max of 4 lanes.
+
+    v = heap_max_i64(v, _mm256_permute2x128_si256(v, v, 1));
+    return heap_max_i64(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+HEAP_TARGET("avx2")
+static int heap_select4_i64_avx2(const void* keys) {
+
+    __m256i v = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i m = heap_max4_i64(v);
+
+    return heap_ctz(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, m))));
+}
+
+HEAP_TARGET("avx2")
+static int heap_select8_i64_avx2(const void* keys) {
+
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)keys + 1);
+    __m256i m = heap_max4_i64(heap_max_i64(v0, v1));
+
+    return heap_ctz(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v0, m)))
+        | _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v1, m))) << 4);
+}
+
+HEAP_TARGET("avx2")
+static int heap_select16_i64_avx2(const void* keys) {
+
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)keys + 1);
+    __m256i v2 = _mm256_loadu_si256((const __m256i*)keys + 2);
+    __m256i v3 = _mm256_loadu_si256((const __m256i*)keys + 3);
+    __m256i m = heap_max4_i64(heap_max_i64(heap_max_i64(v0, v1), heap_max_i64(v2, v3)));
+
+    return heap_ctz(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v0, m)))
+        | _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v1, m))) << 4
+        | _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v2, m))) << 8
+        | _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v3, m))) << 12);
+}
+
+///////////////////////
+// CPU detection
+///////////////////////
+
+static int heap_simd_detect(void) {
+
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 19)) == 0)                                                 // SSE4.1
+        return HEAP_SIMD_NONE;
+
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)                        // OS saves the YMM state (OSXSAVE + XCR0)
+        return HEAP_SIMD_SSE41;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) ? HEAP_SIMD_AVX2 : HEAP_SIMD_SSE41;                 // AVX2
+#else
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return HEAP_SIMD_AVX2;
+
+    return __builtin_cpu_supports("sse4.1") ? HEAP_SIMD_SSE41 : HEAP_SIMD_NONE;
+#endif
+}
+
+#endif // HEAP_SIMD_X86
+
+///////////////////////////////////////
+// Public interface: Heap SIMD API
+///////////////////////////////////////
+
+static int heap_simd_detected = -1;                                                 // -1 until the CPU has been probed.
+static int heap_simd_cap = HEAP_SIMD_AVX2;
+
+int heap_simd_level(void) {
+
+    if (heap_simd_detected < 0) {                                                   // Racing first calls all store the same value.
+#ifdef HEAP_SIMD_X86
+        heap_simd_detected = heap_simd_detect();
+#else
+        heap_simd_detected = HEAP_SIMD_NONE;
+#endif
+    }
+
+    return heap_simd_detected < heap_simd_cap ? heap_simd_detected : heap_simd_cap;
+}
+
+int heap_simd_set_level(int level) {
+
+    heap_simd_cap = level;
+
+    return heap_simd_level();
+}
+
+HeapSelect heap_simd_select(int keytype, int arity) {
+
+#ifdef HEAP_SIMD_X86
+    int level = heap_simd_level();
+
+    if (keytype == HEAP_KEY_I32) {
+
+        if (level >= HEAP_SIMD_AVX2 && arity == 8)
+            return heap_select8_i32_avx2;
+        if (level >= HEAP_SIMD_AVX2 && arity == 16)
+            return heap_select16_i32_avx2;
+        if (level >= HEAP_SIMD_SSE41 && arity == 4)
+            return heap_select4_i32_sse41;
+        if (level >= HEAP_SIMD_SSE41 && arity == 8)
+            return heap_select8_i32_sse41;
+        if (level >= HEAP_SIMD_SSE41 && arity == 16)
+            return heap_select16_i32_sse41;
+
+    } else if (keytype == HEAP_KEY_I64 && level >= HEAP_SIMD_AVX2) {
+
+        if (arity == 4)
+            return heap_select4_i64_avx2;
+        if (arity == 8)
+            return heap_select8_i64_avx2;
+        if (arity == 16)
+            return heap_select16_i64_avx2;
+    }
+#else
+    (void)keytype;
+    (void)arity;
+#endif
+
+    return NULL;                                                                    // Binary heaps and plain CPUs use the scalar loop.
+}
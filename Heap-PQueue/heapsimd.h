@@ -0,0 +1,35 @@
+// heapsimd.h - vectorized child selection for integer-keyed heaps
+///////////////////////////////////////////////////////////////////
+#ifndef HEAPSIMD_H
+#define HEAPSIMD_H
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// For heaps built with heap_init_keyed the sift-down step "pick the largest of the d
+// children" is a max-reduction over d packed int32 / int64 keys. The kernels here do it
+// in a few SSE4.1 / AVX2 instructions. The CPU is probed once at run time; machines
+// (or builds) without SSE4.1 get NULL and the heap falls back to its scalar loop.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define HEAP_SIMD_NONE  0
+#define HEAP_SIMD_SSE41 1
+#define HEAP_SIMD_AVX2  2
+
+// Returns the index (0 .. arity-1) of the first largest key in a full sibling group.
+typedef int (*HeapSelect)(const void* keys);
+
+////////////////////////////////////////////
+// Public interface: Heap SIMD API
+////////////////////////////////////////////
+
+// Best kernel for arity packed keys of keytype (HEAP_KEY_I32 / HEAP_KEY_I64) on this
+// CPU, or NULL when none applies.
+HeapSelect heap_simd_select(int keytype, int arity);
+
+// Instruction set the kernels use: the detected level, capped by heap_simd_set_level.
+int heap_simd_level(void);
+
+// Cap the instruction set (e.g. HEAP_SIMD_NONE to benchmark the scalar path). Affects
+// heaps whose keys or arity are set afterwards. Returns the resulting level.
+int heap_simd_set_level(int level);
+
+#endif
@@ -0,0 +1,164 @@
+// heapt.h - heap template
+//////////////////////////
+#ifndef HEAPT_H
+#define HEAPT_H
+
+#include <stdlib.h>
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Type-specialized Heap - Macro Template
+/////////////////////////////////////////
+//
+// HEAP_TEMPLATE(Type, prefix, elem, higher) expands to a by-value max-heap of elem
+// whose comparison is the expression higher(a, b) (a, b are const elem*; nonzero when
+// *a must sit above *b). Because higher is expanded in place rather than called
+// through Heap::compare, the compiler inlines it into the sift loops.
+//
+//     HEAP_TEMPLATE(IntHeap, intheap, int, heapt_value_higher)
+//
+//     IntHeap heap;
+//     int value = 5;
+//     intheap_init(&heap);
+//     intheap_insert(&heap, &value);
+//     intheap_extract(&heap, &value);
+//     intheap_destroy(&heap);
+//
+// The generated functions take the same arguments and return the same 0 / -1 codes
+// as the pqueue_* API on a heap_init_sized queue, so moving a queue over is a rename.
+// Capacity management (HEAP_MIN_CAPACITY, x2 growth, shrink at 1/4) matches Heap.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define heapt_value_higher(a, b) (*(a) > *(b))
+
+#define heapt_priority_higher(a, b) ((a)->priority > (b)->priority)
+
+#define HEAP_TEMPLATE(Type, prefix, elem, higher)                                                   \
+                                                                                                    \
+typedef struct Type##_ {                                                                            \
+                                                                                                    \
+	int size;                                                                                       \
+	int capacity;                                                                                   \
+                                                                                                    \
+	elem* tree;                                                                                     \
+                                                                                                    \
+} Type;                                                                                             \
+                                                                                                    \
+static inline void prefix##_init(Type* heap) {                                                      \
+                                                                                                    \
+    heap->size = 0;                                                                                 \
+    heap->capacity = 0;                                                                             \
+    heap->tree = NULL;                                                                              \
+}                                                                                                   \
+                                                                                                    \
+static inline void prefix##_destroy(Type* heap) {                                                   \
+                                                                                                    \
+    free(heap->tree);                                                                               \
+    prefix##_init(heap);                                                                            \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_resize(Type* heap, int capacity) {                                       \
+                                                                                                    \
+    elem* temp;                                                                                     \
+                                                                                                    \
+    if (capacity == 0) {                                                                            \
+        free(heap->tree);                                                                           \
+        heap->tree = NULL;                                                                          \
+        heap->capacity = 0;                                                                         \
+        return 0;                                                                                   \
+    }                                                                                               \
+                                                                                                    \
+    if ((temp = (elem*)realloc(heap->tree, (size_t)capacity * sizeof(elem))) == NULL)               \
+        return -1;                                                                                  \
+                                                                                                    \
+    heap->tree = temp;                                                                              \
+    heap->capacity = capacity;                                                                      \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_reserve(Type* heap, int capacity) {                                      \
+                                                                                                    \
+    return capacity <= heap->capacity ? 0 : prefix##_resize(heap, capacity);                        \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_shrink_to_fit(Type* heap) {                                              \
+                                                                                                    \
+    return heap->capacity == heap->size ? 0 : prefix##_resize(heap, heap->size);                    \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_insert(Type* heap, const elem* data) {                                   \
+                                                                                                    \
+    int ipos;                                                                                       \
+    int ppos;                                                                                       \
+                                                                                                    \
+    if (heap->size == heap->capacity) {                                                             \
+        if (prefix##_resize(heap, heap->capacity == 0 ? HEAP_MIN_CAPACITY : heap->capacity * 2))    \
+            return -1;                                                                              \
+    }                                                                                               \
+                                                                                                    \
+    ipos = heap->size;                                                                              \
+                                                                                                    \
+    while (ipos > 0) {                                                                              \
+                                                                                                    \
+        ppos = (ipos - 1) / 2;                                                                      \
+        if (!(higher(data, &heap->tree[ppos])))                                                     \
+            break;                                                                                  \
+        heap->tree[ipos] = heap->tree[ppos];                                                        \
+        ipos = ppos;                                                                                \
+    }                                                                                               \
+                                                                                                    \
+    heap->tree[ipos] = *data;                                                                       \
+    heap->size++;                                                                                   \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_extract(Type* heap, elem* data) {                                        \
+                                                                                                    \
+    elem save;                                                                                      \
+    int ipos;                                                                                       \
+    int mpos;                                                                                       \
+                                                                                                    \
+    if (heap->size == 0)                                                                            \
+        return -1;                                                                                  \
+                                                                                                    \
+    *data = heap->tree[0];                                                                          \
+    save = heap->tree[--heap->size];                                                                \
+    ipos = 0;                                                                                       \
+                                                                                                    \
+    while ((mpos = ipos * 2 + 1) < heap->size) {                                                    \
+                                                                                                    \
+        if (mpos + 1 < heap->size && higher(&heap->tree[mpos + 1], &heap->tree[mpos]))              \
+            mpos++;                                                                                 \
+        if (!(higher(&heap->tree[mpos], &save)))                                                    \
+            break;                                                                                  \
+        heap->tree[ipos] = heap->tree[mpos];                                                        \
+        ipos = mpos;                                                                                \
+    }                                                                                               \
+                                                                                                    \
+    if (heap->size > 0)                                                                             \
+        heap->tree[ipos] = save;                                                                    \
+                                                                                                    \
+    if (heap->capacity > HEAP_MIN_CAPACITY && heap->size <= heap->capacity / 4)                     \
+        prefix##_resize(heap, heap->capacity / 2);                                                  \
+                                                                                                    \
+    return 0;                                                                                       \
+}                                                                                                   \
+                                                                                                    \
+static inline elem* prefix##_peek(Type* heap) {                                                     \
+                                                                                                    \
+    return heap->size == 0 ? NULL : &heap->tree[0];                                                 \
+}                                                                                                   \
+                                                                                                    \
+static inline int prefix##_size(const Type* heap) {                                                 \
+                                                                                                    \
+    return heap->size;                                                                              \
+}
+
+////////////////////////////////////////
+// Stock instance: int max-heap
+////////////////////////////////////////
+
+HEAP_TEMPLATE(IntHeap, intheap, int, heapt_value_higher)
+
+#endif
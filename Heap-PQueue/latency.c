@@ -0,0 +1,267 @@
+// latency.c : per-thread log-bucketed latency histograms.
+//////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#endif
+
+#include "latency.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros and state used by the histograms.
+////////////////////////////////////////////////////////////
+
+#ifdef _MSC_VER
+#define LAT_TLS __declspec(thread)
+#else
+#define LAT_TLS __thread
+#endif
+
+typedef struct LatThread_ {
+
+    unsigned long long bucket[LAT_SITES][LAT_BUCKETS];                              // written by the owner thread only; never
+                                                                                    // cleared, so wide enough not to wrap
+    unsigned int max[LAT_SITES];                                                    // ns, for the interval in epoch
+    unsigned int epoch[LAT_SITES];
+
+} LatThread;
+
+unsigned int latency_on;
+
+static LatThread lat_threads[LAT_MAX_THREADS];
+static unsigned int lat_nthreads;                                                   // slots claimed, may pass LAT_MAX_THREADS
+static unsigned int lat_dropped;
+static unsigned int lat_epoch[LAT_SITES];                                           // bumped by every reset of the site
+static LAT_TLS int lat_slot;                                                        // 1 + this thread's slot, 0 = none yet, -1 = none left
+
+static unsigned int lat_lock;                                                       // readers only: guards lat_base
+static unsigned long long lat_base[LAT_SITES][LAT_BUCKETS];                         // bucket sums at the last reset
+
+static const char* const lat_names[LAT_SITES] = { "get_parcel", "put_parcel", "pqueue_insert", "pqueue_extract" };
+
+static int lat_log2(unsigned int v) {                                               // v > 0
+
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanReverse(&bit, v);
+    return (int)bit;
+#else
+    return 31 - __builtin_clz(v);
+#endif
+}
+
+static int lat_index(unsigned int ns) {
+
+    int e;
+
+    if (ns < (1u << LAT_SUB_BITS))
+        return (int)ns;
+
+    e = lat_log2(ns);                                                               // Power of two, then the top LAT_SUB_BITS below it.
+    return ((e - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + (int)((ns >> (e - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1));
+}
+
+static unsigned long long lat_upper(int idx) {                                      // Largest value in bucket idx.
+
+    int e;
+
+    if (idx < (1 << LAT_SUB_BITS))
+        return (unsigned long long)idx;
+
+    e = (idx >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    return ((unsigned long long)((1 << LAT_SUB_BITS) + (idx & ((1 << LAT_SUB_BITS) - 1)) + 1) << (e - LAT_SUB_BITS)) - 1;
+}
+
+static void lat_read_lock(void) {
+
+    while (!qatomic_cas(&lat_lock, 0, 1))
+        qatomic_pause();
+}
+
+static void lat_read_unlock(void) {
+
+    qatomic_store_release(&lat_lock, 0);
+}
+
+static int lat_threads_used(void) {
+
+    unsigned int n = qatomic_load_acquire(&lat_nthreads);
+
+    return n < LAT_MAX_THREADS ? (int)n : LAT_MAX_THREADS;
+}
+
+// Sum every thread's buckets for site into sum. Caller holds lat_lock.
+static void lat_sum(int site, unsigned long long* sum) {
+
+    int n = lat_threads_used();
+    int t, i;
+
+    memset(sum, 0, LAT_BUCKETS * sizeof(unsigned long long));
+
+    for (t = 0; t < n; t++)
+        for (i = 0; i < LAT_BUCKETS; i++)
+            sum[i] += qatomic_load_relaxed64(&lat_threads[t].bucket[site][i]);
+}
+
+/////////////////////////////////////////
+// Public interface: Latency API
+/////////////////////////////////////////
+// void latency_enable(int on)
+// unsigned long long latency_now(void)
+// void latency_record(int site, unsigned long long ns)
+// void latency_snapshot(int site, LatencyHist* hist)
+// void latency_reset(int site)
+// unsigned long long latency_percentile(const LatencyHist* hist, double q)
+// unsigned long long latency_dropped(void)
+// void latency_dump(const char* name)
+/////////////////////////////////////////
+
+void latency_enable(int on) {
+
+    qatomic_store_release(&latency_on, on ? 1u : 0u);
+}
+
+unsigned long long latency_now(void) {
+
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (unsigned long long)(count.QuadPart / freq.QuadPart) * 1000000000ULL
+        + (unsigned long long)(count.QuadPart % freq.QuadPart) * 1000000000ULL / (unsigned long long)freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+void latency_record(int site, unsigned long long ns) {
+
+    LatThread* thread;
+    unsigned long long* bucket;
+    unsigned int epoch;
+    unsigned int v = ns > LAT_MAX_NS ? (unsigned int)LAT_MAX_NS : (unsigned int)ns;
+    unsigned int n;
+
+    if (lat_slot == 0) {                                                            // First sample of this thread: claim a slot.
+        n = qatomic_fetch_add(&lat_nthreads, 1);
+        lat_slot = n < LAT_MAX_THREADS ? (int)n + 1 : -1;
+    }
+
+    if (lat_slot < 0) {
+        qatomic_fetch_add(&lat_dropped, 1);
+        return;
+    }
+
+    thread = &lat_threads[lat_slot - 1];
+    bucket = &thread->bucket[site][lat_index(v)];
+    qatomic_store_relaxed64(bucket, qatomic_load_relaxed64(bucket) + 1);           // Sole writer: no read-modify-write needed.
+
+    epoch = qatomic_load_relaxed(&lat_epoch[site]);
+    if (thread->epoch[site] != epoch) {                                             // First sample since a reset: restart the max,
+        qatomic_store_relaxed(&thread->max[site], v);                               // then publish which interval it belongs to.
+        qatomic_store_release(&thread->epoch[site], epoch);
+    }
+    else if (v > thread->max[site])
+        qatomic_store_relaxed(&thread->max[site], v);
+}
+
+void latency_snapshot(int site, LatencyHist* hist) {
+
+    unsigned int epoch;
+    unsigned int max;
+    int n, t, i;
+
+    lat_read_lock();
+
+    lat_sum(site, hist->bucket);
+    hist->count = 0;
+    for (i = 0; i < LAT_BUCKETS; i++) {
+        hist->bucket[i] -= lat_base[site][i];
+        hist->count += hist->bucket[i];
+    }
+
+    hist->max = 0;
+    epoch = qatomic_load_relaxed(&lat_epoch[site]);
+    n = lat_threads_used();
+    for (t = 0; t < n; t++) {                                                       // Maxima from before the reset do not count.
+        if (qatomic_load_acquire(&lat_threads[t].epoch[site]) == epoch
+            && (max = qatomic_load_relaxed(&lat_threads[t].max[site])) > hist->max)
+            hist->max = max;
+    }
+
+    lat_read_unlock();
+}
+
+void latency_reset(int site) {
+
+    int s;
+
+    lat_read_lock();
+
+    for (s = 0; s < LAT_SITES; s++) {
+        if (site < 0 || site == s) {
+            lat_sum(s, lat_base[s]);
+            qatomic_fetch_add(&lat_epoch[s], 1);
+        }
+    }
+
+    lat_read_unlock();
+}
+
+unsigned long long latency_percentile(const LatencyHist* hist, double q) {
+
+    unsigned long long seen = 0;
+    double rank = q * (double)hist->count;
+    int i;
+
+    if (hist->count == 0)
+        return 0;
+
+    if (rank < 1)
+        rank = 1;
+
+    for (i = 0; i < LAT_BUCKETS; i++) {
+        seen += hist->bucket[i];
+        if ((double)seen >= rank)
+            return lat_upper(i) < hist->max ? lat_upper(i) : hist->max;
+    }
+
+    return hist->max;
+}
+
+unsigned long long latency_dropped(void) {
+
+    return qatomic_load_relaxed(&lat_dropped);
+}
+
+void latency_dump(const char* name) {
+
+    static LatencyHist hist;                                                        // ~4 KB: keep it off the stack.
+    int site;
+
+    for (site = 0; site < LAT_SITES; site++) {
+
+        latency_snapshot(site, &hist);
+        if (hist.count == 0)
+            continue;
+
+        fprintf(stdout, "Latency %s %-14s n=%-10llu p50=%lluns p99=%lluns p99.9=%lluns max=%lluns\n", name, lat_names[site],
+            hist.count, latency_percentile(&hist, 0.50), latency_percentile(&hist, 0.99),
+            latency_percentile(&hist, 0.999), hist.max);
+    }
+
+    if (latency_dropped() > 0)
+        fprintf(stdout, "Latency %s: %llu samples dropped (more than %d threads)\n", name, latency_dropped(), LAT_MAX_THREADS);
+}
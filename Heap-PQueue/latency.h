@@ -0,0 +1,88 @@
+// latency.h - per-thread log-bucketed latency histograms
+//////////////////////////////////////////////////////////
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "qatomic.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Latency Histograms - Data Struct
+///////////////////////////////////
+//
+// Every timed call site (LAT_*) has one histogram per thread. A sample of v ns lands in
+// an HDR-style bucket: values below 16 get a bucket each, larger ones are split into
+// 16 linear sub-buckets per power of two, so a bucket is never wider than 1/16 of its
+// value (about 6% resolution) from nanoseconds up to LAT_MAX_NS.
+//
+//     bucket  0 .. 15:  v = 0 .. 15
+//     bucket 16 .. 31:  v = 16 .. 31       (exponent 4, width 1)
+//     bucket 32 .. 47:  v = 32 .. 62 step 2 (exponent 5, width 2) ...
+//
+// Recording touches only the calling thread's buckets: one relaxed load and one
+// relaxed store, no lock and no read-modify-write. Readers (latency_snapshot,
+// latency_reset) sum all threads' buckets; a reset moves a per-site baseline rather
+// than clearing buckets under a thread that may be recording.
+//
+// Timing is switched on at run time with latency_enable(1); while it is off every
+// timed call costs one relaxed load. The first LAT_MAX_THREADS threads that record
+// get histograms, samples from later threads are counted in latency_dropped().
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define LAT_GET_PARCEL      0
+#define LAT_PUT_PARCEL      1
+#define LAT_PQUEUE_INSERT   2
+#define LAT_PQUEUE_EXTRACT  3
+#define LAT_SITES           4
+
+#define LAT_SUB_BITS        4                                  // 16 sub-buckets per power of two
+#define LAT_MAX_EXP         32                                 // values clamp to 2^32 - 1 ns (~4.3 s)
+#define LAT_BUCKETS         ((LAT_MAX_EXP - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+#define LAT_MAX_NS          ((1ULL << LAT_MAX_EXP) - 1)
+#define LAT_MAX_THREADS     64
+
+// Samples of one site, summed over threads, since the last latency_reset.
+typedef struct LatencyHist_ {
+
+	unsigned long long count;
+	unsigned long long max;                                    // ns
+	unsigned long long bucket[LAT_BUCKETS];
+
+} LatencyHist;
+
+/////////////////////////////////////////
+// Public interface: Latency API
+/////////////////////////////////////////
+
+extern unsigned int latency_on;
+
+void latency_enable(int on);
+
+// Monotonic clock in ns.
+unsigned long long latency_now(void);
+
+// Add one sample of ns to site's histogram for the calling thread.
+void latency_record(int site, unsigned long long ns);
+
+// Sum of all threads' samples for site since the last reset.
+void latency_snapshot(int site, LatencyHist* hist);
+
+// Start a new interval for site, or for every site when site < 0.
+void latency_reset(int site);
+
+// Smallest bucket upper bound at or below which a fraction q (0 .. 1) of the samples
+// fall, capped at max; 0 for an empty histogram.
+unsigned long long latency_percentile(const LatencyHist* hist, double q);
+
+// Samples lost to threads beyond LAT_MAX_THREADS.
+unsigned long long latency_dropped(void);
+
+// Print count, p50, p99, p99.9 and max of every site with samples to stdout.
+void latency_dump(const char* name);
+
+// Time a call: t0 = latency_begin(); ... latency_end(LAT_x, t0). Free while disabled.
+#define latency_begin() (qatomic_load_relaxed(&latency_on) ? latency_now() : 0ULL)
+
+#define latency_end(site, t0) \
+	((t0) != 0 ? latency_record((site), latency_now() - (t0)) : (void)0)
+
+#endif
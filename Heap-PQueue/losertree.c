@@ -0,0 +1,201 @@
+// losertree.c : loser-tree K-way merge of sorted Parcel streams.
+//////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "losertree.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the loser tree.
+////////////////////////////////////////////////////////////
+
+#define loser_key(input, index) heap_stable_key((input)->items[(input)->next].priority, (index))
+
+#define loser_index(key) ((int)heap_stable_seq(key))
+
+// Leaf of input index is node k + index; node n's parent is n / 2.
+#define loser_leaf(tree, index) ((tree)->k + (index))
+
+// Play key, the new head of input index (the last winner), up its path to the root.
+// Each node keeps the lower of the two keys and the higher one moves on.
+static void loser_replay(LoserTree* tree, int index, long long key) {
+
+    long long* node = tree->tree;
+    long long loser;
+    int n;
+
+    for (n = loser_leaf(tree, index) >> 1; n > 0; n >>= 1) {
+
+        loser = node[n];                                                            // Min / max rather than a branch the random
+        node[n] = loser < key ? loser : key;                                        // keys would mispredict half the time.
+        key = loser < key ? key : loser;
+    }
+
+    node[0] = key;
+}
+
+// Key of input index once its buffer is used up: fetch the next one through more.
+// Returns -1, fetching nothing, if more fails.
+static int loser_fetch(LoserInput* input, int index, long long* key) {
+
+    const Parcel* items;
+    int size;
+
+    if (input->more == NULL || (size = input->more(input->ctx, &items)) == 0) {
+        *key = LOSER_DONE;
+        return 0;
+    }
+
+    if (size < 0)
+        return -1;
+
+    input->items = items;
+    input->size = size;
+    input->next = 0;
+    *key = loser_key(input, index);
+
+    return 0;
+}
+
+// Bring input index, the current winner, to its next parcel and replay its path.
+static int loser_advance(LoserTree* tree, int index) {
+
+    LoserInput* input = &tree->inputs[index];
+    long long key;
+
+    if (input->next < input->size)
+        key = loser_key(input, index);
+    else if (loser_fetch(input, index, &key) != 0)                                 // Still the winner with its old key: the next
+        return -1;                                                                  // call sees the empty buffer and retries.
+
+    loser_replay(tree, index, key);
+
+    return 0;
+}
+
+///////////////////////////////////////////
+// Public interface: Loser Tree API
+///////////////////////////////////////////
+// void loser_input(LoserInput* input, const Parcel* items, int n, int (*more)(void* ctx, const Parcel** items), void* ctx)
+// int  loser_init(LoserTree* tree, LoserInput* inputs, int k)
+// void loser_destroy(LoserTree* tree)
+// int  loser_merge(LoserTree* tree, Parcel* out, int max)
+// const Parcel* loser_peek(LoserTree* tree)
+///////////////////////////////////////////
+
+void loser_input(LoserInput* input, const Parcel* items, int n,
+    int (*more)(void* ctx, const Parcel** items), void* ctx) {
+
+    input->items = items;
+    input->size = n > 0 ? n : 0;
+    input->next = 0;
+    input->more = more;
+    input->ctx = ctx;
+
+    return;
+}
+
+int loser_init(LoserTree* tree, LoserInput* inputs, int k) {
+
+    long long* win;
+    long long a, b;
+    int i, n;
+
+    memset(tree, 0, sizeof(LoserTree));
+
+    if (k < 1)
+        return -1;
+
+    if ((tree->tree = (long long*)malloc((size_t)k * sizeof(long long))) == NULL)
+        return -1;
+    if ((win = (long long*)malloc((size_t)2 * k * sizeof(long long))) == NULL) {   // Winner of every node while building.
+        free(tree->tree);
+        tree->tree = NULL;
+        return -1;
+    }
+
+    tree->k = k;
+    tree->inputs = inputs;
+
+    for (i = 0; i < k; i++) {                                                       // Leaves: every input's first key.
+
+        if (inputs[i].next < inputs[i].size)
+            win[loser_leaf(tree, i)] = loser_key(&inputs[i], i);
+        else if (loser_fetch(&inputs[i], i, &win[loser_leaf(tree, i)]) != 0) {
+            free(win);
+            loser_destroy(tree);
+            return -1;
+        }
+    }
+
+    for (n = k - 1; n > 0; n--) {                                                   // Play every match bottom-up once.
+
+        a = win[2 * n];
+        b = win[2 * n + 1];
+        win[n] = a > b ? a : b;
+        tree->tree[n] = a > b ? b : a;
+    }
+
+    tree->tree[0] = win[1];                                                         // k = 1: the single leaf is node 1.
+    free(win);
+
+    return 0;
+}
+
+void loser_destroy(LoserTree* tree) {
+
+    free(tree->tree);
+
+    memset(tree, 0, sizeof(LoserTree));                                             // Clear the structure to be on the safe side.
+
+    return;
+}
+
+int loser_merge(LoserTree* tree, Parcel* out, int max) {
+
+    LoserInput* input;
+    int count = 0;
+    int index;
+
+    while (count < max && tree->tree[0] != LOSER_DONE) {
+
+        index = loser_index(tree->tree[0]);
+        input = &tree->inputs[index];
+
+        if (input->next == input->size) {                                           // An earlier fetch failed: try again first.
+            if (loser_advance(tree, index) != 0)
+                break;
+            continue;
+        }
+
+        memcpy(&out[count++], &input->items[input->next++], sizeof(Parcel));
+
+        if (loser_advance(tree, index) != 0)
+            break;
+    }
+
+    tree->merged += count;
+
+    return count > 0 || tree->tree[0] == LOSER_DONE || max <= 0 ? count : -1;
+}
+
+const Parcel* loser_peek(LoserTree* tree) {
+
+    LoserInput* input;
+    int index;
+
+    while (tree->tree[0] != LOSER_DONE) {
+
+        index = loser_index(tree->tree[0]);
+        input = &tree->inputs[index];
+
+        if (input->next < input->size)
+            return &input->items[input->next];
+
+        if (loser_advance(tree, index) != 0)
+            return NULL;
+    }
+
+    return NULL;
+}
@@ -0,0 +1,80 @@
+// losertree.h - loser-tree (tournament) K-way merge of sorted Parcel streams
+///////////////////////////////////////////////////////////////////////////////
+#ifndef LOSERTREE_H
+#define LOSERTREE_H
+
+#include <limits.h>
+
+#include "parcel.h"
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// A loser tree merges k input streams, each sorted highest priority first, into one
+// stream in the same order. Inputs are the leaves of a tournament; every internal node
+// keeps the loser of the match played there and node 0 the overall winner. After the
+// winner is output only its own leaf-to-root path is replayed against the next parcel
+// of its input: one comparison per level, log2 k in all, and no look at sibling nodes,
+// where a binary heap of stream heads compares about 2 log2 k times per element.
+//
+// The tree is a single array of k packed 64-bit keys, heap_stable_key(priority, input):
+// the input index rides in the low word, so a node is one long long and a match one
+// integer compare, and equal priorities come out in input order (lowest index first).
+// An exhausted input plays as LOSER_DONE, below every real key.
+//
+// Each input is a cursor over a buffer of parcels. When a buffer runs out, the input's
+// more callback (if any) is asked for another; inputs without one end with their
+// buffer. Output goes to caller buffers in batches with loser_merge.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define LOSER_DONE LLONG_MIN                                   // key of an input that has ended
+
+typedef struct LoserInput_ {
+
+	const Parcel* items;                                       // current buffer, highest priority first
+	int size;
+	int next;                                                  // first parcel of items not yet merged
+
+	// Point *items at the input's next buffer and return its length; 0 at the end of
+	// the input, -1 on error. NULL: the input ends with its first buffer.
+	int (*more)(void* ctx, const Parcel** items);
+	void* ctx;
+
+} LoserInput;
+
+typedef struct LoserTree_ {
+
+	int k;
+	long long* tree;                                           // tree[0] winner, tree[1 .. k-1] the loser of each match
+	LoserInput* inputs;                                        // the caller's array of k cursors
+
+	long long merged;                                          // parcels output since init
+
+} LoserTree;
+
+///////////////////////////////////////////
+// Public interface: Loser Tree API
+///////////////////////////////////////////
+
+// Cursor over one sorted buffer of n parcels, fetching more through more(ctx, &items)
+// unless more is NULL.
+void loser_input(LoserInput* input, const Parcel* items, int n,
+	int (*more)(void* ctx, const Parcel** items), void* ctx);
+
+// Play the first tournament over k (>= 1) inputs. inputs must stay in place until
+// loser_destroy. Returns -1 if memory runs out or an input's more fails.
+int loser_init(LoserTree* tree, LoserInput* inputs, int k);
+
+void loser_destroy(LoserTree* tree);
+
+// Write up to max more parcels of the merged stream to out. Returns the number written,
+// 0 once every input has ended, or -1 if an input's more failed before anything was
+// written (the call can be repeated; nothing is lost).
+int loser_merge(LoserTree* tree, Parcel* out, int max);
+
+// The parcel loser_merge will write next, or NULL at the end (or if fetching the
+// winning input's next buffer fails).
+const Parcel* loser_peek(LoserTree* tree);
+
+#define loser_done(loser) ((loser)->tree[0] == LOSER_DONE)
+
+#endif
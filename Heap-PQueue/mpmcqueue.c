@@ -0,0 +1,111 @@
+// mpmcqueue.c : lock-free bounded MPMC circular queue.
+////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpmcqueue.h"
+#include "qatomic.h"
+
+///////////////////////////////////////////////
+// Public interface: MPMC Circular Queue API
+///////////////////////////////////////////////
+// int initQueue_mpmc(struct MPMCQueue* q, int capacity)
+// void destroyQueue_mpmc(struct MPMCQueue* q)
+// int enQueue_mpmc(struct MPMCQueue* q, int value)
+// int deQueue_mpmc(struct MPMCQueue* q, int* value)
+// int queueSize_mpmc(struct MPMCQueue* q)
+///////////////////////////////////////////////
+
+int initQueue_mpmc(struct MPMCQueue* q, int capacity) {
+
+    unsigned int size = 2;
+    unsigned int i;
+
+    memset(q, 0, sizeof(struct MPMCQueue));
+
+    if (capacity <= 0 || capacity > (1 << 30))
+        return -1;
+
+    while (size < (unsigned int)capacity)
+        size *= 2;
+
+    if ((q->cells = (struct MPMCCell*)malloc(size * sizeof(struct MPMCCell))) == NULL)
+        return -1;
+
+    for (i = 0; i < size; i++)                                                      // Cell i is free for position i.
+        q->cells[i].seq = i;
+
+    q->mask = size - 1;
+
+    return 0;
+}
+
+void destroyQueue_mpmc(struct MPMCQueue* q) {
+
+    free(q->cells);
+    memset(q, 0, sizeof(struct MPMCQueue));
+}
+
+int enQueue_mpmc(struct MPMCQueue* q, int value) {
+
+    struct MPMCCell* cell;
+    unsigned int pos = qatomic_load_relaxed(&q->rear);
+    int dif;
+
+    for (;;) {
+
+        cell = &q->cells[pos & q->mask];
+        dif = (int)(qatomic_load_acquire(&cell->seq) - pos);
+
+        if (dif == 0) {                                                             // Free for this lap: try to claim the position.
+            if (qatomic_cas(&q->rear, pos, pos + 1))
+                break;
+            pos = qatomic_load_relaxed(&q->rear);
+        }
+        else if (dif < 0)                                                           // Still holds last lap's value: the queue is full.
+            return MPMC_FULL;
+        else                                                                        // Another producer took pos; catch up.
+            pos = qatomic_load_relaxed(&q->rear);
+    }
+
+    cell->data = value;
+    qatomic_store_release(&cell->seq, pos + 1);                                     // Hand the cell to the consumer of pos.
+
+    return 0;
+}
+
+int deQueue_mpmc(struct MPMCQueue* q, int* value) {
+
+    struct MPMCCell* cell;
+    unsigned int pos = qatomic_load_relaxed(&q->front);
+    int dif;
+
+    for (;;) {
+
+        cell = &q->cells[pos & q->mask];
+        dif = (int)(qatomic_load_acquire(&cell->seq) - (pos + 1));
+
+        if (dif == 0) {                                                             // Filled for this lap: try to claim the position.
+            if (qatomic_cas(&q->front, pos, pos + 1))
+                break;
+            pos = qatomic_load_relaxed(&q->front);
+        }
+        else if (dif < 0)                                                           // Not produced yet: the queue is empty.
+            return MPMC_EMPTY;
+        else                                                                        // Another consumer took pos; catch up.
+            pos = qatomic_load_relaxed(&q->front);
+    }
+
+    *value = cell->data;
+    qatomic_store_release(&cell->seq, pos + q->mask + 1);                           // Free the cell for the producer one lap later.
+
+    return 0;
+}
+
+int queueSize_mpmc(struct MPMCQueue* q) {
+
+    int size = (int)(qatomic_load_relaxed(&q->rear) - qatomic_load_relaxed(&q->front));
+
+    return size < 0 ? 0 : size > (int)q->mask + 1 ? (int)q->mask + 1 : size;
+}
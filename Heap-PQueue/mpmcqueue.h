@@ -0,0 +1,55 @@
+// mpmcqueue.h - lock-free multi-producer / multi-consumer circular queue
+///////////////////////////////////////////////////////////////////////////
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Bounded MPMC Circular Queue - Data Struct (Vyukov)
+/////////////////////////////////////////////////////
+//
+// A fixed power-of-two ring of cells, each carrying a sequence number next to its int.
+// For the cell at position pos (masked into the ring):
+//
+//     seq == pos           free: the producer that claims rear == pos may fill it
+//     seq == pos + 1       full: the consumer that claims front == pos may empty it
+//     seq == pos + size    emptied: free again for the producer one lap later
+//
+// Producers claim rear and consumers claim front with one CAS each; the cell's seq is
+// then published with a release store, so no two threads ever touch the same cell at
+// once and nobody waits on a lock. rear and front live on separate cache lines.
+// The queue never grows: a full queue makes enQueue_mpmc fail instead of blocking.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+struct MPMCCell {
+    unsigned int seq;
+    int data;
+};
+
+struct MPMCQueue {
+    struct MPMCCell* cells;
+    unsigned int mask;          // capacity - 1
+    char pad0[HEAP_CACHE_LINE - sizeof(struct MPMCCell*) - sizeof(unsigned int)];
+    unsigned int rear;          // next position to fill, claimed by producers
+    char pad1[HEAP_CACHE_LINE - sizeof(unsigned int)];
+    unsigned int front;         // next position to empty, claimed by consumers
+    char pad2[HEAP_CACHE_LINE - sizeof(unsigned int)];
+};
+
+#define MPMC_FULL  -1
+#define MPMC_EMPTY -1
+
+///////////////////////////////////////////////
+// Public interface: MPMC Circular Queue API
+///////////////////////////////////////////////
+
+// Room for capacity values, rounded up to a power of two (at least 2). Not thread-safe,
+// nor is destroyQueue_mpmc; everything else may be called from any number of threads.
+int initQueue_mpmc(struct MPMCQueue* q, int capacity);
+void destroyQueue_mpmc(struct MPMCQueue* q);
+int enQueue_mpmc(struct MPMCQueue* q, int value);                // 0, or MPMC_FULL
+int deQueue_mpmc(struct MPMCQueue* q, int* value);               // 0, or MPMC_EMPTY
+int queueSize_mpmc(struct MPMCQueue* q);                         // a snapshot; exact only when quiescent
+
+#endif
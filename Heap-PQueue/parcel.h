@@ -4,7 +4,7 @@
 
 typedef struct Parcel_ {
 
-	int priority;
+	int priority;                                              // must stay first: keyed heaps read it at offset 0
 
 } Parcel;
 
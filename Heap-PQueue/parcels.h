@@ -5,14 +5,97 @@
 
 #include "parcel.h"
 #include "pqueue.h"
+#include "heapt.h"
 
 ///////////////////////////////////
 // Public Interface: Parcels API
 ///////////////////////////////////
 
+// Init parcels to store Parcels by value, highest priority first. Queues set up
+// with pqueue_init instead hold malloc'd Parcels and need destroy = free; with
+// pqueue_init_alloc they hold Parcels from that allocator (e.g. a Pool).
+void parcels_init(PQueue* parcels);
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+
+// Slot of a stable parcels queue: the parcel behind a packed heap_stable_key.
+typedef struct StableParcel_ {
+
+	long long key;                                             // priority, then arrival order; must stay first
+	Parcel parcel;
+
+} StableParcel;
+
+// Init parcels by value like parcels_init, but parcels of equal priority come out in
+// the order they were put (FIFO). Every Parcels API call works on either kind of queue.
+void parcels_init_stable(PQueue* parcels);
+
+#endif // PQUEUE_BACKEND
+
 int get_parcel(PQueue* parcels, Parcel* parcel);
 
 int put_parcel(PQueue* parcels, const Parcel* parcel);
 
+// Bulk-load n parcels in one O(n) heapify, e.g. at startup or queue restore.
+int load_parcels(PQueue* parcels, const Parcel* items, int n);
+
+// Batch forms of get_parcel / put_parcel. get_parcels returns the number of parcels
+// written to out (at most max, highest priority first), or -1 on failure.
+int get_parcels(PQueue* parcels, Parcel* out, int max);
+
+int put_parcels(PQueue* parcels, const Parcel* items, int n);
+
+// Top-K: the k highest-priority parcels of a stream, in O(k) memory whatever its length.
+// The kept parcels sit in a by-value Heap with their priorities bit-inverted, so the
+// lowest kept priority is at the root. A parcel no higher than that is turned away
+// after one compare; a higher one takes the root's place with a single heap_replace
+// sift-down. On equal priorities the parcel kept first stays. Always a Heap, whatever
+// PQUEUE_BACKEND is.
+typedef struct ParcelTopK_ {
+
+	Heap best;                                                 // ~priority keyed: the weakest parcel kept at the root
+	int k;
+
+	long long offered;                                         // parcels put since init or the last topk_get_parcels
+	long long rejected;                                        // turned away at the root
+
+} ParcelTopK;
+
+// Keep the k (>= 1) highest-priority parcels; room for k is allocated up front.
+int parcels_topk_init(ParcelTopK* topk, int k);
+
+void parcels_topk_destroy(ParcelTopK* topk);
+
+int topk_put_parcel(ParcelTopK* topk, const Parcel* parcel);
+
+int topk_put_parcels(ParcelTopK* topk, const Parcel* items, int n);
+
+// Take the kept parcels out, highest priority first, and start over with an empty set.
+// Returns the number written to out: at most max, the highest ones when more are kept.
+int topk_get_parcels(ParcelTopK* topk, Parcel* out, int max);
+
+#define parcels_topk_size(topk) heap_size(&(topk)->best)
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+
+// put_parcel that also passes back a handle for the parcel while it is queued
+// (enabling handles on parcels on first use).
+int put_parcel_handle(PQueue* parcels, const Parcel* parcel, int* handle);
+
+// Change the priority of a queued parcel in O(log n).
+int reprioritize_parcel(PQueue* parcels, int handle, int priority);
+
+// Withdraw a queued parcel, copying it to parcel unless parcel is NULL.
+int cancel_parcel(PQueue* parcels, int handle, Parcel* parcel);
+
+#endif // PQUEUE_BACKEND
+
+////////////////////////////////////////////////////////////////////
+// ParcelHeap: compile-time specialized Parcel max-heap on priority
+// (parcel_heap_init / _insert / _extract / _peek / _size / _destroy)
+////////////////////////////////////////////////////////////////////
+
+HEAP_TEMPLATE(ParcelHeap, parcel_heap, Parcel, heapt_priority_higher)
+
 #endif
 
@@ -0,0 +1,482 @@
+// parcelwal.c : write-ahead log with group commit for a durable Parcels queue.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "parcelwal.h"
+#include "latency.h"
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP
+
+////////////////////////////////////////////////////////////
+//  Define private macros and records used by the log.
+////////////////////////////////////////////////////////////
+//
+// <base>.wal:  [WalHeader][WalFrame][records] [WalFrame][records] ...
+// record:      op ('P' put, 'G' get) followed by the Parcel put or got
+
+#ifdef _WIN32
+#define wal_open_fd(path) _open((path), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define wal_close_fd(fd) _close(fd)
+#define wal_read_fd(fd, data, bytes) _read((fd), (data), (unsigned int)(bytes))
+#define wal_write_fd(fd, data, bytes) _write((fd), (data), (unsigned int)(bytes))
+#define wal_sync_fd(fd) _commit(fd)
+#define wal_seek_fd(fd, offset) _lseeki64((fd), (offset), SEEK_SET)
+#define wal_truncate_fd(fd, offset) (_chsize_s((fd), (offset)) == 0 ? 0 : -1)
+#else
+#define wal_open_fd(path) open((path), O_RDWR | O_CREAT, 0644)
+#define wal_close_fd(fd) close(fd)
+#define wal_read_fd(fd, data, bytes) read((fd), (data), (size_t)(bytes))
+#define wal_write_fd(fd, data, bytes) write((fd), (data), (size_t)(bytes))
+#ifdef __APPLE__
+#define wal_sync_fd(fd) fsync(fd)
+#else
+#define wal_sync_fd(fd) fdatasync(fd)                                               // The file size is covered; no need for mtime.
+#endif
+#define wal_seek_fd(fd, offset) lseek((fd), (off_t)(offset), SEEK_SET)
+#define wal_truncate_fd(fd, offset) ftruncate((fd), (off_t)(offset))
+#endif
+
+#define PARCELWAL_MAGIC   0x4c415750u                                               // "PWAL"
+#define PARCELWAL_VERSION 1
+
+#define wal_record_bytes ((int)(1 + sizeof(Parcel)))
+
+typedef struct WalHeader_ {
+
+    unsigned int magic;
+    unsigned int version;
+    int esize;                                                                      // of the queue's slots
+    int size;                                                                       // of the queue the log starts from
+    unsigned long long base;                                                        // wal_queue_hash of that queue
+
+} WalHeader;
+
+typedef struct WalFrame_ {
+
+    unsigned int bytes;                                                             // of the records that follow
+    unsigned int count;
+    unsigned long long checksum;                                                    // wal_hash over bytes, count and records
+
+} WalFrame;
+
+// FNV-1a over 64-bit words, then the tail bytes, continuing from hash.
+static unsigned long long wal_hash(unsigned long long hash, const void* data, size_t bytes) {
+
+    const char* p = (const char*)data;
+    unsigned long long word;
+    size_t i;
+
+    for (i = 0; i + 8 <= bytes; i += 8) {
+        memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ (unsigned char)p[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+#define WAL_HASH_SEED 14695981039346656037ULL
+
+// Identity of the queue's state: its tree as laid out (which a snapshot restores byte
+// for byte) and the stable-mode counter, which decides the keys of later puts.
+static unsigned long long wal_queue_hash(const PQueue* parcels) {
+
+    unsigned long long hash = wal_hash(WAL_HASH_SEED, &parcels->size, sizeof(int));
+
+    hash = wal_hash(hash, &parcels->seq, sizeof(unsigned int));
+
+    return parcels->size == 0 ? hash
+        : wal_hash(hash, parcels->tree, (size_t)parcels->size * parcels->esize);
+}
+
+static unsigned long long wal_frame_hash(const WalFrame* frame, const char* records) {
+
+    unsigned long long hash = wal_hash(WAL_HASH_SEED, &frame->bytes, sizeof(unsigned int));
+
+    hash = wal_hash(hash, &frame->count, sizeof(unsigned int));
+
+    return wal_hash(hash, records, frame->bytes);
+}
+
+static int wal_write_all(int fd, const char* data, size_t bytes) {
+
+    long long done;
+
+    for (; bytes > 0; data += done, bytes -= (size_t)done)
+        if ((done = (long long)wal_write_fd(fd, data, bytes)) <= 0)
+            return -1;
+
+    return 0;
+}
+
+static int wal_read_all(int fd, char* data, size_t bytes) {                        // -1 on a short read: a torn frame.
+
+    long long done;
+
+    for (; bytes > 0; data += done, bytes -= (size_t)done)
+        if ((done = (long long)wal_read_fd(fd, data, bytes)) <= 0)
+            return -1;
+
+    return 0;
+}
+
+static void wal_path(char* path, const ParcelWal* wal, const char* ext) {
+
+    sprintf(path, "%s.%s", wal->base, ext);
+}
+
+// Start an empty log based on the queue as it is now.
+static int wal_reset(ParcelWal* wal) {
+
+    WalHeader header;
+
+    header.magic = PARCELWAL_MAGIC;
+    header.version = PARCELWAL_VERSION;
+    header.esize = wal->parcels->esize;
+    header.size = wal->parcels->size;
+    header.base = wal_queue_hash(wal->parcels);
+
+    if (wal_truncate_fd(wal->fd, 0) != 0 || wal_seek_fd(wal->fd, 0) < 0
+        || wal_write_all(wal->fd, (const char*)&header, sizeof(WalHeader)) != 0
+        || wal_sync_fd(wal->fd) != 0)
+        return -1;
+
+    wal->offset = sizeof(WalHeader);
+
+    return 0;
+}
+
+// Apply the records of one frame to the queue.
+static int wal_apply(ParcelWal* wal, const char* records, int count) {
+
+    Parcel parcel, got;
+    int i;
+
+    for (i = 0; i < count; i++, records += wal_record_bytes) {
+
+        memcpy(&parcel, records + 1, sizeof(Parcel));
+
+        if (records[0] == 'P') {
+            if (put_parcel(wal->parcels, &parcel) != 0)
+                return -1;
+        }
+        else if (records[0] != 'G' || get_parcel(wal->parcels, &got) != 0
+            || memcmp(&got, &parcel, sizeof(Parcel)) != 0)                          // Replay must hand out what was logged.
+            return -1;
+
+        wal->replayed++;
+    }
+
+    return 0;
+}
+
+// Replay the frames after the header; the log is cut after the last good one.
+static int wal_replay(ParcelWal* wal) {
+
+    WalFrame frame;
+    char* records = NULL;
+    char* grown;
+    unsigned int capacity = 0;
+    int status = 0;
+
+    while (wal_read_all(wal->fd, (char*)&frame, sizeof(WalFrame)) == 0) {
+
+        if (frame.bytes != frame.count * (unsigned int)wal_record_bytes || frame.bytes > PARCELWAL_BUFFER)
+            break;
+
+        if (frame.bytes > capacity) {
+            if ((grown = (char*)realloc(records, frame.bytes)) == NULL) {
+                status = -1;
+                break;
+            }
+            records = grown;
+            capacity = frame.bytes;
+        }
+
+        if (wal_read_all(wal->fd, records, frame.bytes) != 0 || wal_frame_hash(&frame, records) != frame.checksum)
+            break;                                                                  // Torn or corrupt: the commit never finished.
+
+        if (wal_apply(wal, records, (int)frame.count) != 0) {
+            status = -1;
+            break;
+        }
+
+        wal->offset += sizeof(WalFrame) + frame.bytes;
+    }
+
+    free(records);
+
+    if (status == 0 && (wal_truncate_fd(wal->fd, wal->offset) != 0 || wal_seek_fd(wal->fd, wal->offset) < 0))
+        status = -1;
+
+    return status;
+}
+
+#define wal_capacity ((PARCELWAL_BUFFER - (int)sizeof(WalFrame)) / wal_record_bytes)   // records per frame
+
+// Make room in the buffer for n (<= wal_capacity) more records, committing it if full.
+// Called before the queue is touched: an op that cannot be logged is not applied.
+static int wal_reserve(ParcelWal* wal, int n) {
+
+    if (wal->used + n * wal_record_bytes > PARCELWAL_BUFFER && parcels_wal_sync(wal) != 0)
+        return -1;
+
+    return 0;
+}
+
+// Buffer a record; wal_reserve has made room for it.
+static void wal_append(ParcelWal* wal, char op, const Parcel* parcel) {
+
+    if (wal->count == 0)
+        wal->first = latency_now();
+
+    wal->buffer[wal->used] = op;
+    memcpy(wal->buffer + wal->used + 1, parcel, sizeof(Parcel));
+    wal->used += wal_record_bytes;
+    wal->count++;
+    wal->records++;
+
+    return;
+}
+
+// Commit if the budget is used up. The op is already applied and its record buffered,
+// so a failed commit is not its failure: the records stay buffered and the next sync
+// retries them (and reports it), where failing the op would have it repeated.
+static void wal_settle(ParcelWal* wal) {
+
+    parcels_wal_poll(wal);
+
+    return;
+}
+
+// 1: the header matches the queue, replay the log. 0: start a new log - there is no
+// header (a new or torn log), or it is one a checkpoint left behind, based on an older
+// state than the snapshot now loaded, whose records the snapshot already holds.
+// -1: a log this queue cannot take (another format or esize, or not based on the
+// loaded state when there is no snapshot to explain it); it is left as it is.
+static int wal_check(ParcelWal* wal, const WalHeader* header, int snapshot) {
+
+    const char* zero = (const char*)header;
+    size_t i;
+
+    for (i = 0; i < sizeof(WalHeader) && zero[i] == 0; i++)
+        ;
+    if (i == sizeof(WalHeader))                                                     // Zero-filled: the header write never landed.
+        return 0;
+
+    if (header->magic != PARCELWAL_MAGIC || header->version != PARCELWAL_VERSION
+        || header->esize != wal->parcels->esize)
+        return -1;
+
+    if (header->size == wal->parcels->size && header->base == wal_queue_hash(wal->parcels))
+        return 1;
+
+    return snapshot ? 0 : -1;
+}
+
+///////////////////////////////////////////
+// Public interface: Parcels WAL API
+///////////////////////////////////////////
+// int parcels_wal_open(ParcelWal* wal, PQueue* parcels, const char* base, int budget_us)
+// int parcels_wal_close(ParcelWal* wal)
+// int wal_put_parcel(ParcelWal* wal, const Parcel* parcel)
+// int wal_get_parcel(ParcelWal* wal, Parcel* parcel)
+// int wal_put_parcels(ParcelWal* wal, const Parcel* items, int n)
+// int wal_get_parcels(ParcelWal* wal, Parcel* out, int max)
+// int parcels_wal_sync(ParcelWal* wal)
+// int parcels_wal_poll(ParcelWal* wal)
+// int parcels_wal_checkpoint(ParcelWal* wal)
+///////////////////////////////////////////
+
+int parcels_wal_open(ParcelWal* wal, PQueue* parcels, const char* base, int budget_us) {
+
+    char path[PARCELWAL_PATH + 8];
+    WalHeader header;
+    FILE* snapshot;
+    int loaded = 0;
+    int check = 0;
+
+    memset(wal, 0, sizeof(ParcelWal));
+    wal->fd = -1;
+
+    if (pqueue_size(parcels) != 0 || parcels->esize == 0 || strlen(base) >= PARCELWAL_PATH || budget_us < 0)
+        return -1;
+
+    wal->parcels = parcels;
+    wal->budget_us = budget_us;
+    strcpy(wal->base, base);
+
+    wal_path(path, wal, "snap");
+    if ((snapshot = fopen(path, "rb")) != NULL) {                                   // No snapshot yet: start from the empty queue.
+        fclose(snapshot);
+        if (pqueue_load(parcels, path) != 0)
+            return -1;
+        loaded = 1;
+    }
+
+    if ((wal->buffer = (char*)malloc(PARCELWAL_BUFFER)) == NULL)
+        return -1;
+    wal->used = sizeof(WalFrame);
+
+    wal_path(path, wal, "wal");
+    if ((wal->fd = wal_open_fd(path)) < 0) {
+        parcels_wal_close(wal);
+        return -1;
+    }
+
+    if (wal_read_all(wal->fd, (char*)&header, sizeof(WalHeader)) == 0)            // Short: new, or torn before its header.
+        check = wal_check(wal, &header, loaded);
+    wal->offset = sizeof(WalHeader);
+
+    if (check < 0 || (check > 0 && wal_replay(wal) != 0)
+        || (check == 0 && (wal_reset(wal) != 0 || heap_dir_sync(path) != 0))) {     // A new log's entry must outlive a crash too.
+        parcels_wal_close(wal);
+        return -1;
+    }
+
+    return 0;
+}
+
+int parcels_wal_close(ParcelWal* wal) {
+
+    int status = 0;
+
+    if (wal->fd >= 0) {
+        status = parcels_wal_sync(wal);
+        wal_close_fd(wal->fd);
+    }
+
+    free(wal->buffer);
+
+    memset(wal, 0, sizeof(ParcelWal));                                              // Clear the structure to be on the safe side.
+    wal->fd = -1;
+
+    return status;
+}
+
+int wal_put_parcel(ParcelWal* wal, const Parcel* parcel) {
+
+    if (wal_reserve(wal, 1) != 0 || put_parcel(wal->parcels, parcel) != 0)
+        return -1;
+
+    wal_append(wal, 'P', parcel);
+    wal_settle(wal);
+
+    return 0;
+}
+
+int wal_get_parcel(ParcelWal* wal, Parcel* parcel) {
+
+    if (pqueue_size(wal->parcels) == 0 || wal_reserve(wal, 1) != 0 || get_parcel(wal->parcels, parcel) != 0)
+        return -1;
+
+    wal_append(wal, 'G', parcel);
+    wal_settle(wal);
+
+    return 0;
+}
+
+int wal_put_parcels(ParcelWal* wal, const Parcel* items, int n) {
+
+    int i, group;
+
+    for (i = 0; i < n; ) {
+
+        group = n - i < wal_capacity ? n - i : wal_capacity;                        // A batch past one frame is
+        if (wal_reserve(wal, group) != 0)                                           // committed a frame at a time.
+            return -1;
+
+        for (group += i; i < group; i++) {
+            if (put_parcel(wal->parcels, &items[i]) != 0)
+                return -1;
+            wal_append(wal, 'P', &items[i]);
+        }
+    }
+
+    wal_settle(wal);
+
+    return 0;
+}
+
+int wal_get_parcels(ParcelWal* wal, Parcel* out, int max) {
+
+    int count = 0;
+    int group;
+
+    while (count < max && pqueue_size(wal->parcels) > 0) {
+
+        group = max - count < wal_capacity ? max - count : wal_capacity;
+        if (group > pqueue_size(wal->parcels))
+            group = pqueue_size(wal->parcels);
+        if (wal_reserve(wal, group) != 0)
+            break;
+
+        for (group += count; count < group && get_parcel(wal->parcels, &out[count]) == 0; count++)
+            wal_append(wal, 'G', &out[count]);
+    }
+
+    wal_settle(wal);
+
+    return count > 0 || max <= 0 || pqueue_size(wal->parcels) == 0 ? count : -1;
+}
+
+int parcels_wal_sync(ParcelWal* wal) {
+
+    WalFrame* frame = (WalFrame*)wal->buffer;
+
+    if (wal->count == 0)
+        return 0;
+
+    frame->bytes = (unsigned int)(wal->used - sizeof(WalFrame));
+    frame->count = (unsigned int)wal->count;
+    frame->checksum = wal_frame_hash(frame, wal->buffer + sizeof(WalFrame));
+
+    if (wal_write_all(wal->fd, wal->buffer, wal->used) != 0 || wal_sync_fd(wal->fd) != 0) {
+
+        wal_truncate_fd(wal->fd, wal->offset);                                      // Drop a partial frame so later commits
+        wal_seek_fd(wal->fd, wal->offset);                                          // are not stranded behind it; keep the
+        return -1;                                                                  // records buffered for a retry.
+    }
+
+    wal->offset += wal->used;
+    wal->used = sizeof(WalFrame);
+    wal->count = 0;
+    wal->commits++;
+
+    return 0;
+}
+
+int parcels_wal_poll(ParcelWal* wal) {
+
+    if (wal->count > 0 && latency_now() - wal->first >= (unsigned long long)wal->budget_us * 1000)
+        return parcels_wal_sync(wal);
+
+    return 0;
+}
+
+int parcels_wal_checkpoint(ParcelWal* wal) {
+
+    char path[PARCELWAL_PATH + 8];
+
+    if (parcels_wal_sync(wal) != 0)
+        return -1;
+
+    wal_path(path, wal, "snap");
+    if (pqueue_save(wal->parcels, path) != 0)                                       // Atomic; the old log no longer matches it.
+        return -1;
+
+    return wal_reset(wal);
+}
+
+#endif // PQUEUE_BACKEND
@@ -0,0 +1,96 @@
+// parcelwal.h - write-ahead log with group commit for a durable Parcels queue
+//////////////////////////////////////////////////////////////////////////////
+#ifndef PARCELWAL_H
+#define PARCELWAL_H
+
+#include "parcels.h"
+
+#if PQUEUE_BACKEND == PQUEUE_HEAP                                  // Recovery starts from a pqueue_save snapshot.
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// A ParcelWal makes a by-value parcels queue durable. Every wal_put_parcel /
+// wal_get_parcel applies the call to the queue and appends a record (one op byte and
+// the Parcel) to an in-memory buffer. The buffer goes to <base>.wal in one write and
+// one fsync - a group commit - when it fills up or when its oldest record has waited
+// budget_us, so the fsync cost is shared by every call in the group.
+//
+// A call therefore returns before its record is on disk: it is durable within
+// budget_us as long as the queue keeps being used or parcels_wal_poll is called (from
+// an idle loop or timer), and at once after parcels_wal_sync. budget_us = 0 commits
+// every call.
+//
+// parcels_wal_checkpoint saves the queue to <base>.snap (pqueue_save) and starts an
+// empty log. The log header holds a hash of the queue it starts from, and
+// parcels_wal_open replays the log only onto a snapshot with that hash: a crash
+// between writing the snapshot and resetting the log never applies records twice.
+// Each commit is a frame with its own checksum; replay stops at the first torn or
+// corrupt frame and cuts the log there.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define PARCELWAL_BUFFER (64 * 1024)                           // bytes of records per group commit, at most
+#define PARCELWAL_PATH   260
+
+typedef struct ParcelWal_ {
+
+	PQueue* parcels;
+	int fd;                                                    // <base>.wal, open for appending
+	long long offset;                                          // end of the last committed frame
+	int budget_us;
+
+	char* buffer;                                              // frame header, then the records not yet committed
+	int used;                                                  // bytes in buffer, frame header included
+	int count;                                                 // records in buffer
+	unsigned long long first;                                  // latency_now() of the oldest record in buffer
+
+	long long records;                                         // logged since open
+	long long commits;                                         // group commits (write + fsync) since open
+	long long replayed;                                        // records applied by parcels_wal_open
+
+	char base[PARCELWAL_PATH];
+
+} ParcelWal;
+
+///////////////////////////////////////////
+// Public interface: Parcels WAL API
+///////////////////////////////////////////
+
+// Recover and open. parcels must be initialized (parcels_init or parcels_init_stable,
+// whichever the log was written with) and empty. Loads <base>.snap if there is one,
+// replays <base>.wal on top and keeps logging to it. Returns -1 if the files cannot
+// be opened, the snapshot is unreadable or the log does not fit the queue (another
+// esize, or based on a state neither the snapshot nor an empty queue has); such a log
+// is left untouched. Only a log with no header, or one a checkpoint already folded into
+// the snapshot, is started over.
+int parcels_wal_open(ParcelWal* wal, PQueue* parcels, const char* base, int budget_us);
+
+// Commit what is pending and close the log. The queue stays as it is.
+int parcels_wal_close(ParcelWal* wal);
+
+// put_parcel / get_parcel / put_parcels / get_parcels, logged. The batch forms apply
+// their parcels one at a time, as replay will, so a replayed queue is the same heap
+// slot for slot and parcels of equal priority still come out in the logged order.
+// Room for the records is made (committing a full buffer) before the queue changes, so
+// an op that returns -1 was not applied; a batch past one buffer is applied and logged a
+// buffer at a time, and wal_put_parcels returning -1 may have put the groups before.
+// A commit that fails once an op's record is buffered is left for the next sync (or
+// poll, checkpoint, close) to retry and report, not returned by the op.
+int wal_put_parcel(ParcelWal* wal, const Parcel* parcel);
+
+int wal_get_parcel(ParcelWal* wal, Parcel* parcel);
+
+int wal_put_parcels(ParcelWal* wal, const Parcel* items, int n);
+
+int wal_get_parcels(ParcelWal* wal, Parcel* out, int max);
+
+// Commit pending records now, if any.
+int parcels_wal_sync(ParcelWal* wal);
+
+// Commit pending records if the oldest has used up the latency budget.
+int parcels_wal_poll(ParcelWal* wal);
+
+// Snapshot the queue and truncate the log, bounding the next recovery.
+int parcels_wal_checkpoint(ParcelWal* wal);
+
+#endif // PQUEUE_BACKEND
+
+#endif
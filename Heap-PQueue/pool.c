@@ -0,0 +1,332 @@
+// pool.c : fixed-size object pool with per-thread caches.
+///////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+#include "qatomic.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros and state used by the pools.
+////////////////////////////////////////////////////////////
+
+#ifdef _MSC_VER
+#define POOL_TLS __declspec(thread)
+#else
+#define POOL_TLS __thread
+#endif
+
+#define POOL_ALIGN (2 * sizeof(void*))                                              // malloc's alignment on the usual ABIs
+
+#define pool_next(object) (*(void**)(object))
+
+typedef struct PoolCache_ {
+
+    void* free;
+    int count;
+    unsigned int epoch;                                                             // pool epoch the objects belong to; 0 = none
+    long long allocs;                                                               // not yet folded into the pool's stats
+    long long frees;
+
+} PoolCache;
+
+static POOL_TLS PoolCache pool_cache[POOL_MAX_CACHED];
+
+static unsigned int pool_slots;                                                     // bit s set while cache slot s is taken
+static unsigned int pool_epochs;
+
+static void pool_lock(Pool* pool) {
+
+    while (!qatomic_cas(&pool->lock, 0, 1))
+        qatomic_pause();
+}
+
+static void pool_unlock(Pool* pool) {
+
+    qatomic_store_release(&pool->lock, 0);
+}
+
+// Pop one object off the shared list, carving a new slab when it is empty. Locked.
+static void* pool_take(Pool* pool) {
+
+    char* slab;
+    void* object;
+    int i;
+
+    if (pool->free == NULL) {
+
+        if ((slab = (char*)malloc(POOL_ALIGN + (size_t)pool->per_slab * pool->osize)) == NULL)
+            return NULL;
+
+        pool_next(slab) = pool->slabs;                                              // The first POOL_ALIGN bytes link the slabs.
+        pool->slabs = slab;
+
+        for (i = pool->per_slab - 1; i >= 0; i--) {                                 // Thread the objects in address order.
+            object = slab + POOL_ALIGN + (size_t)i * pool->osize;
+            pool_next(object) = pool->free;
+            pool->free = object;
+        }
+
+        pool->stats.slabs++;
+        pool->stats.objects += pool->per_slab;
+        pool->stats.free_shared += pool->per_slab;
+    }
+
+    object = pool->free;
+    pool->free = pool_next(object);
+    pool->stats.free_shared--;
+
+    return object;
+}
+
+static void pool_give(Pool* pool, void* object) {
+
+    pool_next(object) = pool->free;
+    pool->free = object;
+    pool->stats.free_shared++;
+}
+
+// Fold a cache's counters into the pool. Locked.
+static void pool_fold(Pool* pool, PoolCache* cache) {
+
+    pool->stats.allocs += cache->allocs;
+    pool->stats.frees += cache->frees;
+    cache->allocs = 0;
+    cache->frees = 0;
+}
+
+// This thread's cache for pool, or NULL when the pool is uncached.
+static PoolCache* pool_cache_get(Pool* pool) {
+
+    PoolCache* cache;
+
+    if (pool->slot < 0)
+        return NULL;
+
+    cache = &pool_cache[pool->slot];
+
+    if (cache->epoch != pool->epoch) {                                              // Left over from a destroyed pool: its slabs are gone.
+        memset(cache, 0, sizeof(PoolCache));
+        cache->epoch = pool->epoch;
+    }
+
+    return cache;
+}
+
+// Blocks past osize (a cqueue ring that outgrew it) come from malloc, behind a
+// POOL_ALIGN header that links them on the pool's large list.
+static void* pool_allocator_alloc(void* ctx, size_t size) {
+
+    Pool* pool = (Pool*)ctx;
+    char* block;
+
+    if (size <= pool->osize)
+        return pool_alloc(pool);
+
+    if ((block = (char*)malloc(POOL_ALIGN + size)) == NULL)
+        return NULL;
+
+    pool_lock(pool);
+    pool_next(block) = pool->large;
+    pool->large = block;
+    qatomic_store_release(&pool->nlarge, pool->nlarge + 1);
+    pool->stats.large++;
+    pool_unlock(pool);
+
+    return block + POOL_ALIGN;
+}
+
+static void pool_allocator_free(void* ctx, void* ptr) {
+
+    Pool* pool = (Pool*)ctx;
+    void** link;
+
+    if (ptr != NULL && qatomic_load_acquire(&pool->nlarge) != 0) {                  // Few at a time: a ring or two.
+
+        pool_lock(pool);
+        for (link = &pool->large; *link != NULL; link = (void**)*link) {
+            if ((char*)*link + POOL_ALIGN == (char*)ptr) {
+                *link = pool_next(*link);
+                qatomic_store_release(&pool->nlarge, pool->nlarge - 1);
+                pool_unlock(pool);
+                free((char*)ptr - POOL_ALIGN);
+                return;
+            }
+        }
+        pool_unlock(pool);
+    }
+
+    pool_free(pool, ptr);
+}
+
+/////////////////////////////////////
+// Public interface: Object Pool API
+/////////////////////////////////////
+// int   pool_init(Pool* pool, size_t osize)
+// void  pool_destroy(Pool* pool)
+// void* pool_alloc(Pool* pool)
+// void  pool_free(Pool* pool, void* object)
+// void  pool_stats(Pool* pool, PoolStats* stats)
+// void  pool_dump(Pool* pool, const char* name)
+/////////////////////////////////////
+
+int pool_init(Pool* pool, size_t osize) {
+
+    unsigned int slots;
+    int s;
+
+    memset(pool, 0, sizeof(Pool));
+
+    if (osize == 0 || osize > POOL_SLAB_BYTES)
+        return -1;
+
+    if (osize < sizeof(void*))                                                      // A free object must hold the list link.
+        osize = sizeof(void*);
+    pool->osize = (osize + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+    pool->per_slab = (int)((POOL_SLAB_BYTES - POOL_ALIGN) / pool->osize);
+    if (pool->per_slab < 1)
+        pool->per_slab = 1;
+
+    pool->slot = -1;
+    pool->epoch = qatomic_fetch_add(&pool_epochs, 1) + 1;
+    pool->stats.osize = pool->osize;
+
+    do {                                                                            // Claim a free cache slot, if any.
+        slots = qatomic_load_acquire(&pool_slots);
+        for (s = 0; s < POOL_MAX_CACHED && (slots & (1u << s)) != 0; s++)
+            ;
+    } while (s < POOL_MAX_CACHED && !qatomic_cas(&pool_slots, slots, slots | (1u << s)));
+
+    if (s < POOL_MAX_CACHED)
+        pool->slot = s;
+
+    pool->allocator.alloc = pool_allocator_alloc;
+    pool->allocator.free = pool_allocator_free;
+    pool->allocator.ctx = pool;
+
+    return 0;
+}
+
+void pool_destroy(Pool* pool) {
+
+    unsigned int slots;
+    void* slab;
+
+    while ((slab = pool->slabs) != NULL) {
+        pool->slabs = pool_next(slab);
+        free(slab);
+    }
+
+    while ((slab = pool->large) != NULL) {
+        pool->large = pool_next(slab);
+        free(slab);
+    }
+
+    if (pool->slot >= 0) {                                                          // Release the cache slot; the new epoch of the
+        do                                                                          // next pool there invalidates stale caches.
+            slots = qatomic_load_acquire(&pool_slots);
+        while (!qatomic_cas(&pool_slots, slots, slots & ~(1u << pool->slot)));
+    }
+
+    memset(pool, 0, sizeof(Pool));                                                  // Clear the structure to be on the safe side.
+    pool->slot = -1;
+}
+
+void* pool_alloc(Pool* pool) {
+
+    PoolCache* cache = pool_cache_get(pool);
+    void* object;
+
+    if (cache == NULL) {                                                            // Uncached pool: straight to the shared list.
+        pool_lock(pool);
+        if ((object = pool_take(pool)) != NULL)
+            pool->stats.allocs++;
+        pool_unlock(pool);
+        return object;
+    }
+
+    if (cache->free == NULL) {                                                      // Refill a batch under one lock.
+
+        pool_lock(pool);
+        while (cache->count < POOL_BATCH && (object = pool_take(pool)) != NULL) {
+            pool_next(object) = cache->free;
+            cache->free = object;
+            cache->count++;
+        }
+        pool_fold(pool, cache);
+        pool->stats.refills++;
+        pool_unlock(pool);
+
+        if (cache->free == NULL)
+            return NULL;
+    }
+
+    object = cache->free;
+    cache->free = pool_next(object);
+    cache->count--;
+    cache->allocs++;
+
+    return object;
+}
+
+void pool_free(Pool* pool, void* object) {
+
+    PoolCache* cache = pool_cache_get(pool);
+    void* next;
+    int i;
+
+    if (object == NULL)
+        return;
+
+    if (cache == NULL) {
+        pool_lock(pool);
+        pool_give(pool, object);
+        pool->stats.frees++;
+        pool_unlock(pool);
+        return;
+    }
+
+    pool_next(object) = cache->free;
+    cache->free = object;
+    cache->count++;
+    cache->frees++;
+
+    if (cache->count >= 2 * POOL_BATCH) {                                           // Flush a batch, keeping the other half warm.
+
+        pool_lock(pool);
+        for (i = 0; i < POOL_BATCH; i++) {
+            next = pool_next(cache->free);
+            pool_give(pool, cache->free);
+            cache->free = next;
+        }
+        cache->count -= POOL_BATCH;
+        pool_fold(pool, cache);
+        pool->stats.flushes++;
+        pool_unlock(pool);
+    }
+}
+
+void pool_stats(Pool* pool, PoolStats* stats) {
+
+    PoolCache* cache = pool_cache_get(pool);
+
+    pool_lock(pool);
+    if (cache != NULL)
+        pool_fold(pool, cache);
+    memcpy(stats, &pool->stats, sizeof(PoolStats));
+    pool_unlock(pool);
+}
+
+void pool_dump(Pool* pool, const char* name) {
+
+    PoolStats stats;
+
+    pool_stats(pool, &stats);
+
+    fprintf(stdout, "Pool %s: osize=%d slabs=%lld objects=%lld out=%lld\n", name, (int)stats.osize,  // out = in use + cached
+        stats.slabs, stats.objects, stats.objects - stats.free_shared);
+    fprintf(stdout, "    allocs=%lld frees=%lld refills=%lld flushes=%lld free_shared=%lld large=%lld\n",
+        stats.allocs, stats.frees, stats.refills, stats.flushes, stats.free_shared, stats.large);
+}
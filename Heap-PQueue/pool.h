@@ -0,0 +1,89 @@
+// pool.h - fixed-size object pool
+///////////////////////////////////
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Object Pool - Data Struct
+////////////////////////////
+//
+// Objects of one size are carved out of 64 KB slabs and recycled through free lists
+// threaded through the objects themselves; slabs go back to the system only in
+// pool_destroy. Each thread keeps a small private cache per pool, so the common
+// pool_alloc / pool_free is a pointer pop / push with no lock and no atomic. A thread
+// refills an empty cache, or flushes a full one, POOL_BATCH objects at a time from the
+// shared free list under a spinlock. Objects left in the cache of a thread that exits
+// stay idle until pool_destroy.
+//
+// Up to POOL_MAX_CACHED pools can have thread caches at once; further pools still work
+// but take the lock on every call. pool_allocator() exposes a pool through the
+// HeapAllocator hook (heap_init_alloc, initQueue_alloc); requests larger than osize,
+// such as a queue ring that has outgrown it, fall back to malloc there.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define POOL_BATCH 32                                          // objects moved per cache refill / flush
+#define POOL_MAX_CACHED 16                                     // pools with per-thread caches at once
+#define POOL_SLAB_BYTES (64 * 1024)
+
+typedef struct PoolStats_ {
+
+	size_t osize;                                              // bytes per object, after alignment
+	long long slabs;                                           // slabs allocated
+	long long objects;                                         // objects carved from them
+	long long allocs;                                          // pool_alloc calls (cached calls counted at refill / flush)
+	long long frees;                                           // pool_free calls (likewise)
+	long long refills;                                         // batches moved shared list -> thread cache
+	long long flushes;                                         // batches moved thread cache -> shared list
+	long long free_shared;                                     // objects on the shared free list now
+	long long large;                                           // allocator blocks past osize, taken from malloc
+
+} PoolStats;
+
+typedef struct Pool_ {
+
+	size_t osize;
+	int per_slab;
+	int slot;                                                  // thread-cache slot, or -1 when uncached
+	unsigned int epoch;                                        // tells this pool's caches from a destroyed pool's
+
+	unsigned int lock;                                         // spinlock over everything below
+	void* free;                                                // shared free list
+	void* slabs;                                               // slab list, first word of each slab links the next
+	void* large;                                               // allocator blocks past osize, linked the same way
+	unsigned int nlarge;                                       // blocks on large
+	PoolStats stats;
+
+	HeapAllocator allocator;                                   // this pool behind the HeapAllocator hook
+
+} Pool;
+
+/////////////////////////////////////
+// Public interface: Object Pool API
+/////////////////////////////////////
+
+// Pool of osize-byte objects (osize > 0), aligned for any C type.
+int pool_init(Pool* pool, size_t osize);
+
+// Free every slab. Objects still allocated, or cached by other threads, become invalid.
+void pool_destroy(Pool* pool);
+
+void* pool_alloc(Pool* pool);
+
+void pool_free(Pool* pool, void* object);
+
+// Snapshot of the pool's counters, with the calling thread's cache folded in.
+void pool_stats(Pool* pool, PoolStats* stats);
+
+// Print the counters to stdout.
+void pool_dump(Pool* pool, const char* name);
+
+// The pool as a HeapAllocator. Allocations larger than osize are served by malloc
+// and tracked until freed through it (or pool_destroy); the free side checks that
+// short list first, so it stays cheap while few such blocks are live.
+#define pool_allocator(pool) ((const HeapAllocator*)&(pool)->allocator)
+
+#endif
@@ -5,23 +5,186 @@
 
 #include "heap.h"
 
+#define PQUEUE_HEAP   0                                        // Heap: any compare, pointers or values, handles
+#define PQUEUE_RADIX  1                                        // RadixHeap: keyed values whose extracted keys never go backwards
+#define PQUEUE_BUCKET 2                                        // BucketQueue: keyed values with priorities 0 .. 255, FIFO per priority
+#define PQUEUE_EXTERN 3                                        // ExtHeap: keyed values, bounded memory, the rest spilled to mapped files
+
+#ifndef PQUEUE_BACKEND
+#define PQUEUE_BACKEND PQUEUE_HEAP                             // build with /DPQUEUE_BACKEND=1 (radix), 2 (bucket) or 3 (external)
+#endif
+
+#if PQUEUE_BACKEND == PQUEUE_RADIX
+
+#include "radixheap.h"
+
+typedef RadixHeap PQueue;
+
+////////////////////////////////////////////////////////
+// Public Interface: Priority Queue API (radix backend)
+////////////////////////////////////////////////////////
+
+#define pqueue_init_keyed radix_init_keyed
+
+#define pqueue_destroy radix_destroy
+
+#define pqueue_insert radix_insert
+
+#define pqueue_extract radix_extract
+
+#define pqueue_from_array radix_insert_many
+
+#define pqueue_insert_many radix_insert_many
+
+#define pqueue_extract_k radix_extract_k
+
+#define pqueue_peek radix_peek
+
+#define pqueue_size radix_size
+
+#define pqueue_shrink_to_fit radix_shrink_to_fit
+
+#define pqueue_merge radix_merge
+
+#elif PQUEUE_BACKEND == PQUEUE_BUCKET
+
+#include "bucketqueue.h"
+
+typedef BucketQueue PQueue;
+
+/////////////////////////////////////////////////////////
+// Public Interface: Priority Queue API (bucket backend)
+/////////////////////////////////////////////////////////
+
+#define pqueue_init_keyed bucket_init_keyed
+
+#define pqueue_destroy bucket_destroy
+
+#define pqueue_insert bucket_insert
+
+#define pqueue_extract bucket_extract
+
+#define pqueue_from_array bucket_insert_many
+
+#define pqueue_insert_many bucket_insert_many
+
+#define pqueue_extract_k bucket_extract_k
+
+#define pqueue_peek bucket_peek
+
+#define pqueue_size bucket_size
+
+#define pqueue_shrink_to_fit bucket_shrink_to_fit
+
+#define pqueue_merge bucket_merge
+
+#elif PQUEUE_BACKEND == PQUEUE_EXTERN
+
+#include "extheap.h"
+
+typedef ExtHeap PQueue;
+
+///////////////////////////////////////////////////////////
+// Public Interface: Priority Queue API (external backend)
+///////////////////////////////////////////////////////////
+
+#define pqueue_init_keyed extheap_init_keyed
+
+#define pqueue_set_limit extheap_set_limit
+
+#define pqueue_set_dir extheap_set_dir
+
+#define pqueue_destroy extheap_destroy
+
+#define pqueue_insert extheap_insert
+
+#define pqueue_extract extheap_extract
+
+#define pqueue_from_array extheap_insert_many
+
+#define pqueue_insert_many extheap_insert_many
+
+#define pqueue_extract_k extheap_extract_k
+
+#define pqueue_peek extheap_peek
+
+#define pqueue_size extheap_size
+
+#define pqueue_shrink_to_fit extheap_shrink_to_fit
+
+#define pqueue_merge extheap_merge
+
+#else
+
 typedef Heap PQueue;
 
+#ifndef PQUEUE_ARITY
+#define PQUEUE_ARITY 2                                         // build with /DPQUEUE_ARITY=4 or 8 for a d-ary backend
+#endif
+
 ////////////////////////////////////////
 // Public Interface: Priority Queue API
 ////////////////////////////////////////
 
-#define pqueue_init heap_init
+#define pqueue_init(pqueue, compare, destroy) \
+	(heap_init((pqueue), (compare), (destroy)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+
+#define pqueue_init_alloc(pqueue, compare, alloc) \
+	(heap_init_alloc((pqueue), (compare), (alloc)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+
+#define pqueue_init_sized(pqueue, esize, compare) \
+	(heap_init_sized((pqueue), (esize), (compare)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
+
+#define pqueue_init_keyed(pqueue, esize, keytype) \
+	(heap_init_keyed((pqueue), (esize), (keytype)), (void)heap_set_arity((pqueue), PQUEUE_ARITY))
 
 #define pqueue_destroy heap_destroy
 
+#define pqueue_stats heap_stats
+
+#define pqueue_stats_dump heap_stats_dump
+
 #define pqueue_insert heap_insert
 
 #define pqueue_extract heap_extract
 
-#define pqueue_peek(pqueue) ((pqueue)->tree == NULL ? NULL : (pqueue)->tree[0])
+#define pqueue_from_array heap_build
+
+#define pqueue_insert_many heap_insert_many
+
+#define pqueue_extract_k heap_extract_k
+
+#define pqueue_merge heap_merge
+
+#define pqueue_pushpop heap_pushpop
+
+#define pqueue_replace heap_replace
+
+#define pqueue_peek(pqueue) ((pqueue)->size == 0 ? NULL : heap_elem(pqueue, 0))
 
 #define pqueue_size heap_size
 
+#define pqueue_reserve heap_reserve
+
+#define pqueue_shrink_to_fit heap_shrink_to_fit
+
+#define pqueue_save heap_save
+
+#define pqueue_load heap_load
+
+#define pqueue_enable_handles heap_enable_handles
+
+#define pqueue_insert_handle heap_insert_handle
+
+#define pqueue_update heap_update
+
+#define pqueue_remove heap_remove
+
+#define pqueue_merge_remap heap_merge_remap
+
+#define pqueue_handle_elem heap_handle_elem
+
+#endif // PQUEUE_BACKEND
+
 #endif
 
@@ -0,0 +1,88 @@
+// qatomic.h - minimal atomics for the concurrent queues
+/////////////////////////////////////////////////////////
+#ifndef QATOMIC_H
+#define QATOMIC_H
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// The few 32-bit atomic operations the lock-free queues need, on MSVC (which has no
+// C11 <stdatomic.h> in C mode) and on GCC/Clang (__atomic builtins). Operands are
+// unsigned int lvalues shared between threads; sequence numbers wrap freely and are
+// compared through their signed difference. The ...64 forms load and store unsigned
+// long long counters that must not wrap, untorn even on 32-bit x86.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef _MSC_VER
+
+#include <intrin.h>
+
+#if defined(_M_ARM64)
+
+#define qatomic_load_acquire(p) ((unsigned int)__ldar32((unsigned __int32 volatile*)(p)))
+#define qatomic_store_release(p, v) __stlr32((unsigned __int32 volatile*)(p), (unsigned __int32)(v))
+#define qatomic_pause() __yield()
+
+#else                                                          // x86/x64: plain loads acquire and plain stores release;
+                                                               // the barrier only stops the compiler reordering.
+static __forceinline unsigned int qatomic_load_acquire_(volatile unsigned int* p) {
+
+    unsigned int v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+#define qatomic_load_acquire(p) qatomic_load_acquire_((volatile unsigned int*)(p))
+#define qatomic_store_release(p, v) (_ReadWriteBarrier(), *(volatile unsigned int*)(p) = (v))
+#define qatomic_pause() _mm_pause()
+
+#endif
+
+#define qatomic_load_relaxed(p) (*(volatile unsigned int*)(p))
+#define qatomic_store_relaxed(p, v) (*(volatile unsigned int*)(p) = (v))
+
+#if defined(_M_IX86)                                           // No plain 64-bit moves: go through cmpxchg8b.
+
+static __forceinline void qatomic_store_relaxed64_(volatile __int64* p, __int64 v) {
+
+    __int64 seen = *p;
+    __int64 was;
+
+    while ((was = _InterlockedCompareExchange64(p, v, seen)) != seen)
+        seen = was;
+}
+
+#define qatomic_load_relaxed64(p) ((unsigned long long)_InterlockedCompareExchange64((volatile __int64*)(p), 0, 0))
+#define qatomic_store_relaxed64(p, v) qatomic_store_relaxed64_((volatile __int64*)(p), (__int64)(v))
+
+#else
+
+#define qatomic_load_relaxed64(p) (*(volatile unsigned long long*)(p))
+#define qatomic_store_relaxed64(p, v) (*(volatile unsigned long long*)(p) = (v))
+
+#endif
+
+#define qatomic_cas(p, expected, desired) \
+	(InterlockedCompareExchange((volatile long*)(p), (long)(desired), (long)(expected)) == (long)(expected))
+#define qatomic_fetch_add(p, v) ((unsigned int)InterlockedExchangeAdd((volatile long*)(p), (long)(v)))
+
+#else
+
+#define qatomic_load_relaxed(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define qatomic_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define qatomic_store_relaxed(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define qatomic_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define qatomic_load_relaxed64(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define qatomic_store_relaxed64(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define qatomic_cas(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#define qatomic_fetch_add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define qatomic_pause() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define qatomic_pause() __asm__ __volatile__("yield")
+#else
+#define qatomic_pause() ((void)0)
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,293 @@
+// radixheap.c : radix heap backend for monotone integer-keyed queues.
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "radixheap.h"
+#include "latency.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the radix heap.
+////////////////////////////////////////////////////////////
+
+#define radix_item(bucket, esize, npos) ((bucket)->items + (size_t)(npos) * (esize))
+
+// Map the key at offset 0 of item to an unsigned key extracted smallest first.
+static unsigned long long radix_key(const RadixHeap* heap, const void* item) {
+
+    if (heap->keytype == HEAP_KEY_I32)
+        return (unsigned long long)(0x7fffffffLL - *(const int*)item);             // Largest int first.
+    if (heap->keytype == HEAP_KEY_I64)
+        return 0x7fffffffffffffffULL - (unsigned long long)*(const long long*)item; // Largest long long first (mod 2^64).
+
+    return *(const unsigned long long*)item;
+}
+
+static int radix_bits(unsigned long long x) {                                       // Bit length of x: 0 for 0, 64 for the top bit.
+
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    return _BitScanReverse64(&index, x) ? (int)index + 1 : 0;
+#else
+    if (_BitScanReverse(&index, (unsigned long)(x >> 32)))
+        return (int)index + 33;
+    return _BitScanReverse(&index, (unsigned long)x) ? (int)index + 1 : 0;
+#endif
+#else
+    return x == 0 ? 0 : 64 - __builtin_clzll(x);
+#endif
+}
+
+static int radix_resize(RadixBucket* bucket, int esize, int capacity) {
+
+    char* items;
+
+    if (capacity == 0) {
+        free(bucket->items);
+        bucket->items = NULL;
+        bucket->capacity = 0;
+        return 0;
+    }
+
+    if ((items = (char*)realloc(bucket->items, (size_t)capacity * esize)) == NULL)
+        return -1;
+
+    bucket->items = items;
+    bucket->capacity = capacity;
+
+    return 0;
+}
+
+static int radix_push(RadixHeap* heap, int b, const void* item) {
+
+    RadixBucket* bucket = &heap->bucket[b];
+
+    if (bucket->size == bucket->capacity
+        && radix_resize(bucket, heap->esize, bucket->capacity == 0 ? HEAP_MIN_CAPACITY : bucket->capacity * 2) != 0)
+        return -1;
+
+    memcpy(radix_item(bucket, heap->esize, bucket->size), item, heap->esize);
+    bucket->size++;
+
+    return 0;
+}
+
+// Make room for count[t] more elements in each of the first buckets buckets, so that
+// the pushes that follow cannot fail half way and leave the buckets inconsistent.
+static int radix_reserve(RadixHeap* heap, const int* count, int buckets) {
+
+    RadixBucket* bucket;
+    int t;
+
+    for (t = 0; t < buckets; t++) {
+
+        bucket = &heap->bucket[t];
+        if (bucket->size + count[t] > bucket->capacity
+            && radix_resize(bucket, heap->esize, bucket->size + count[t] > HEAP_MIN_CAPACITY
+                ? bucket->size + count[t] : HEAP_MIN_CAPACITY) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+// Make bucket 0 non-empty: advance last to the smallest key in the first non-empty
+// bucket and spread that bucket over the lower ones. Every element lands strictly
+// lower, since it now agrees with last on bit b - 1 and above.
+static int radix_refill(RadixHeap* heap) {
+
+    RadixBucket* bucket;
+    unsigned long long key;
+    int count[RADIX_BUCKETS] = { 0 };
+    int b;
+    int i;
+
+    if (heap->bucket[0].size > 0)
+        return 0;
+
+    for (b = 1; heap->bucket[b].size == 0; b++)
+        ;
+
+    bucket = &heap->bucket[b];
+    key = radix_key(heap, bucket->items);
+
+    for (i = 1; i < bucket->size; i++) {                                            // New last: the bucket minimum.
+        if (radix_key(heap, radix_item(bucket, heap->esize, i)) < key)
+            key = radix_key(heap, radix_item(bucket, heap->esize, i));
+    }
+
+    for (i = 0; i < bucket->size; i++)                                              // Size every target first.
+        count[radix_bits(radix_key(heap, radix_item(bucket, heap->esize, i)) ^ key)]++;
+
+    if (radix_reserve(heap, count, b) != 0)
+        return -1;
+
+    heap->last = key;
+
+    for (i = 0; i < bucket->size; i++)                                              // Redistribute into the lower buckets.
+        radix_push(heap, radix_bits(radix_key(heap, radix_item(bucket, heap->esize, i)) ^ key), radix_item(bucket, heap->esize, i));
+
+    bucket->size = 0;
+
+    return 0;
+}
+
+//////////////////////////////////////
+// Public interface: Radix Heap API
+//////////////////////////////////////
+// void  radix_init_keyed(RadixHeap* heap, int esize, int keytype)
+// void  radix_destroy(RadixHeap* heap)
+// int   radix_insert(RadixHeap* heap, const void* data)
+// int   radix_extract(RadixHeap* heap, void** data)
+// void* radix_peek(RadixHeap* heap)
+// int   radix_insert_many(RadixHeap* heap, void** items, int n)
+// int   radix_extract_k(RadixHeap* heap, void** data, int k)
+// int   radix_shrink_to_fit(RadixHeap* heap)
+// int   radix_merge(RadixHeap* dst, RadixHeap* src)
+//////////////////////////////////////
+
+void radix_init_keyed(RadixHeap* heap, int esize, int keytype) {
+
+    memset(heap, 0, sizeof(RadixHeap));
+
+    heap->esize = esize;
+    heap->keytype = keytype;
+
+    return;
+}
+
+void radix_destroy(RadixHeap* heap) {
+
+    int b;
+
+    for (b = 0; b < RADIX_BUCKETS; b++)
+        free(heap->bucket[b].items);
+
+    memset(heap, 0, sizeof(RadixHeap));                                             // Clear the structure to be on the safe side.
+
+    return;
+}
+
+int radix_insert(RadixHeap* heap, const void* data) {
+
+    unsigned long long t0 = latency_begin();
+    unsigned long long key = radix_key(heap, data);
+
+    if (key < heap->last)                                                           // Behind the last extract: a radix heap cannot order it.
+        return -1;
+
+    if (radix_push(heap, radix_bits(key ^ heap->last), data) != 0)
+        return -1;
+
+    heap->size++;
+    latency_end(LAT_PQUEUE_INSERT, t0);
+
+    return 0;
+}
+
+int radix_extract(RadixHeap* heap, void** data) {
+
+    RadixBucket* bucket = &heap->bucket[0];
+    unsigned long long t0 = latency_begin();
+
+    if (heap->size == 0 || radix_refill(heap) != 0)
+        return -1;
+
+    bucket->size--;                                                                 // Bucket 0 holds only keys equal to last: take any.
+    memcpy(data, radix_item(bucket, heap->esize, bucket->size), heap->esize);
+    heap->size--;
+    latency_end(LAT_PQUEUE_EXTRACT, t0);
+
+    return 0;
+}
+
+void* radix_peek(RadixHeap* heap) {
+
+    if (heap->size == 0 || radix_refill(heap) != 0)
+        return NULL;
+
+    return radix_item(&heap->bucket[0], heap->esize, heap->bucket[0].size - 1);
+}
+
+int radix_insert_many(RadixHeap* heap, void** items, int n) {
+
+    int i;
+
+    if (n < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {                                                       // Appends are already O(1); no heapify to batch.
+
+        if (radix_insert(heap, (char*)items + (size_t)i * heap->esize) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int radix_extract_k(RadixHeap* heap, void** data, int k) {
+
+    int i;
+
+    for (i = 0; i < k && radix_extract(heap, (void**)((char*)data + (size_t)i * heap->esize)) == 0; i++)
+        ;
+
+    return i;
+}
+
+int radix_shrink_to_fit(RadixHeap* heap) {
+
+    int b;
+
+    for (b = 0; b < RADIX_BUCKETS; b++) {
+
+        if (heap->bucket[b].capacity > heap->bucket[b].size
+            && radix_resize(&heap->bucket[b], heap->esize, heap->bucket[b].size) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int radix_merge(RadixHeap* dst, RadixHeap* src) {
+
+    RadixBucket* bucket;
+    const void* head;
+    int count[RADIX_BUCKETS] = { 0 };
+    int b, i;
+
+    if (dst == src || dst->esize != src->esize || dst->keytype != src->keytype)
+        return -1;
+
+    if (src->size == 0)
+        return 0;
+
+    if ((head = radix_peek(src)) == NULL || radix_key(dst, head) < dst->last)      // src's smallest key must not be behind dst.
+        return -1;
+
+    for (b = 0; b < RADIX_BUCKETS; b++)                                             // Bucket every element against dst's last,
+        for (i = 0; i < src->bucket[b].size; i++)                                   // sizing all targets before the first move.
+            count[radix_bits(radix_key(dst, radix_item(&src->bucket[b], src->esize, i)) ^ dst->last)]++;
+
+    if (radix_reserve(dst, count, RADIX_BUCKETS) != 0)
+        return -1;
+
+    for (b = 0; b < RADIX_BUCKETS; b++) {
+
+        bucket = &src->bucket[b];
+        for (i = 0; i < bucket->size; i++)
+            radix_push(dst, radix_bits(radix_key(dst, radix_item(bucket, src->esize, i)) ^ dst->last), radix_item(bucket, src->esize, i));
+        radix_resize(bucket, src->esize, 0);
+        bucket->size = 0;
+    }
+
+    dst->size += src->size;
+    src->size = 0;
+
+    return 0;
+}
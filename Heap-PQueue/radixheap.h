@@ -0,0 +1,78 @@
+// radixheap.h - radix heap for monotone integer keys
+//////////////////////////////////////////////////////
+#ifndef RADIXHEAP_H
+#define RADIXHEAP_H
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// A radix heap keeps by-value elements in 65 buckets by the highest bit in which their
+// key differs from the last extracted key. Insert is an append; extract empties at most
+// one bucket into lower ones, so every element moves O(log C) times over its life and
+// each pass streams through one contiguous bucket. No comparisons between elements.
+//
+// The price is monotonicity: a key may never be inserted "ahead" of the last extract.
+//   HEAP_KEY_I32 / HEAP_KEY_I64 - largest first, as heap_init_keyed; inserts must not
+//                                 exceed the last extracted key.
+//   RADIX_KEY_U64               - unsigned long long, smallest first (time-ordered
+//                                 queues); inserts must not be below the last extract.
+// The key sits at offset 0 of each esize-byte element, as with keyed heaps.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define RADIX_KEY_U64 3
+
+#define RADIX_BUCKETS 65
+
+typedef struct RadixBucket_ {
+
+	int size;
+	int capacity;
+
+	char* items;
+
+} RadixBucket;
+
+typedef struct RadixHeap_ {
+
+	int size;
+	int esize;
+	int keytype;                                               // HEAP_KEY_I32, HEAP_KEY_I64 or RADIX_KEY_U64
+
+	unsigned long long last;                                   // last extracted key, mapped to smallest-first order
+
+	RadixBucket bucket[RADIX_BUCKETS];                         // bucket[b]: keys whose highest bit differing from last is b - 1
+
+} RadixHeap;
+
+//////////////////////////////////////
+// Public interface: Radix Heap API
+//////////////////////////////////////
+
+void radix_init_keyed(RadixHeap* heap, int esize, int keytype);
+
+void radix_destroy(RadixHeap* heap);
+
+// Returns -1 when data's key would break monotonicity (or on allocation failure).
+int radix_insert(RadixHeap* heap, const void* data);
+
+// data is the address of a caller buffer of esize bytes, as with heap_extract.
+int radix_extract(RadixHeap* heap, void** data);
+
+// The next element radix_extract will return, or NULL. May regroup buckets.
+void* radix_peek(RadixHeap* heap);
+
+// Bulk forms with the heap_insert_many / heap_extract_k layouts and return codes.
+int radix_insert_many(RadixHeap* heap, void** items, int n);
+
+int radix_extract_k(RadixHeap* heap, void** data, int k);
+
+int radix_shrink_to_fit(RadixHeap* heap);
+
+// Move every element of src into dst in O(size(src)), leaving src empty. Returns -1,
+// changing neither, if the layouts differ, memory runs out or src holds a key that
+// dst's extracts have already passed.
+int radix_merge(RadixHeap* dst, RadixHeap* src);
+
+#define radix_size(heap) ((heap)->size)
+
+#endif
@@ -0,0 +1,167 @@
+// spscqueue.c : wait-free SPSC circular queue with batched index publication.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spscqueue.h"
+#include "qatomic.h"
+
+///////////////////////////////////////////////
+// Public interface: SPSC Circular Queue API
+///////////////////////////////////////////////
+// int initQueue_spsc(struct SPSCQueue* q, int capacity, int batch)
+// void destroyQueue_spsc(struct SPSCQueue* q)
+// int enQueue_spsc(struct SPSCQueue* q, int value)
+// int enQueue_spsc_n(struct SPSCQueue* q, const int* values, int n)
+// void flushQueue_spsc(struct SPSCQueue* q)
+// int deQueue_spsc(struct SPSCQueue* q, int* value)
+// int deQueue_spsc_n(struct SPSCQueue* q, int* values, int max)
+///////////////////////////////////////////////
+
+int initQueue_spsc(struct SPSCQueue* q, int capacity, int batch) {
+
+    unsigned int size = 2;
+
+    memset(q, 0, sizeof(struct SPSCQueue));
+
+    if (capacity <= 0 || capacity > (1 << 30))
+        return -1;
+
+    while (size < (unsigned int)capacity)
+        size *= 2;
+
+    if (batch < 1 || (unsigned int)batch > size / 2)
+        return -1;
+
+    if ((q->items = (int*)malloc(size * sizeof(int))) == NULL)
+        return -1;
+
+    q->mask = size - 1;
+    q->batch = (unsigned int)batch;
+
+    return 0;
+}
+
+void destroyQueue_spsc(struct SPSCQueue* q) {
+
+    free(q->items);
+    memset(q, 0, sizeof(struct SPSCQueue));
+}
+
+// Publish side's private index with one release store.
+static void publishQueue_spsc(struct SPSCSide* side) {
+
+    qatomic_store_release(&side->shared, side->next);
+    side->pending = 0;
+}
+
+// Free slots the producer can fill without another look at front.
+static unsigned int roomQueue_spsc(struct SPSCQueue* q) {
+
+    struct SPSCSide* p = &q->producer;
+
+    if (p->next - p->cache > q->mask) {                                             // Full by the cached front: refresh it. Publish first so
+        publishQueue_spsc(p);                                                       // a consumer waiting on us drains and frees room.
+        p->cache = qatomic_load_acquire(&q->consumer.shared);
+    }
+
+    return q->mask + 1 - (p->next - p->cache);
+}
+
+// Values the consumer can read without another look at rear.
+static unsigned int availQueue_spsc(struct SPSCQueue* q) {
+
+    struct SPSCSide* c = &q->consumer;
+
+    if (c->next == c->cache) {                                                      // Empty by the cached rear: refresh it. Publish first so
+        publishQueue_spsc(c);                                                       // a producer waiting on us sees the freed slots.
+        c->cache = qatomic_load_acquire(&q->producer.shared);
+    }
+
+    return c->cache - c->next;
+}
+
+int enQueue_spsc(struct SPSCQueue* q, int value) {
+
+    struct SPSCSide* p = &q->producer;
+
+    if (roomQueue_spsc(q) == 0)
+        return SPSC_FULL;
+
+    q->items[p->next++ & q->mask] = value;
+
+    if (++p->pending >= q->batch)                                                   // One store publishes the whole batch.
+        publishQueue_spsc(p);
+
+    return 0;
+}
+
+int enQueue_spsc_n(struct SPSCQueue* q, const int* values, int n) {
+
+    struct SPSCSide* p = &q->producer;
+    unsigned int room;
+    unsigned int first;
+
+    if (n <= 0 || (room = roomQueue_spsc(q)) == 0)
+        return 0;
+
+    if ((unsigned int)n > room)
+        n = (int)room;
+
+    first = q->mask + 1 - (p->next & q->mask);                                      // Up to the end of the block, then wrap to slot 0.
+    if (first > (unsigned int)n)
+        first = (unsigned int)n;
+    memcpy(&q->items[p->next & q->mask], values, first * sizeof(int));
+    memcpy(q->items, values + first, (n - first) * sizeof(int));
+
+    p->next += (unsigned int)n;
+    publishQueue_spsc(p);
+
+    return n;
+}
+
+void flushQueue_spsc(struct SPSCQueue* q) {
+
+    if (q->producer.pending > 0)
+        publishQueue_spsc(&q->producer);
+}
+
+int deQueue_spsc(struct SPSCQueue* q, int* value) {
+
+    struct SPSCSide* c = &q->consumer;
+
+    if (availQueue_spsc(q) == 0)
+        return SPSC_EMPTY;
+
+    *value = q->items[c->next++ & q->mask];
+
+    if (++c->pending >= q->batch)
+        publishQueue_spsc(c);
+
+    return 0;
+}
+
+int deQueue_spsc_n(struct SPSCQueue* q, int* values, int max) {
+
+    struct SPSCSide* c = &q->consumer;
+    unsigned int avail;
+    unsigned int first;
+
+    if (max <= 0 || (avail = availQueue_spsc(q)) == 0)
+        return 0;
+
+    if ((unsigned int)max > avail)
+        max = (int)avail;
+
+    first = q->mask + 1 - (c->next & q->mask);
+    if (first > (unsigned int)max)
+        first = (unsigned int)max;
+    memcpy(values, &q->items[c->next & q->mask], first * sizeof(int));
+    memcpy(values + first, q->items, (max - first) * sizeof(int));
+
+    c->next += (unsigned int)max;
+    publishQueue_spsc(c);
+
+    return max;
+}
@@ -0,0 +1,67 @@
+// spscqueue.h - wait-free single-producer / single-consumer circular queue
+////////////////////////////////////////////////////////////////////////////
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include "heap.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// SPSC Circular Queue - Data Struct
+////////////////////////////////////
+//
+// A fixed power-of-two ring between exactly one producer thread and one consumer
+// thread. Each side owns one cache line of private state and one shared index:
+//
+//     producer line:  shared = rear  |  next = tail, cache = last seen front, pending
+//     consumer line:  shared = front |  next = head, cache = last seen rear,  pending
+//
+// The producer writes at its private tail and publishes rear with one release store
+// every batch values (or on flushQueue_spsc), so a burst of enQueue_spsc calls costs a
+// single store to the shared line. It re-reads the consumer's front only when its
+// cached copy says the ring is full; the consumer does the same with rear. In the
+// steady state neither side touches the other's line, and every call finishes in a
+// bounded number of steps.
+//
+// With batch > 1 a producer that goes idle must call flushQueue_spsc, or the consumer
+// will not see the last pending values.
+///////////////////////////////////////////////////////////////////////////////////////////
+
+struct SPSCSide {
+    unsigned int shared;        // rear / front: the only field the other thread reads
+    unsigned int next;          // tail / head: next position to write / read
+    unsigned int cache;         // last seen value of the other side's shared index
+    unsigned int pending;       // positions moved since shared was last published
+    char pad[HEAP_CACHE_LINE - 4 * sizeof(unsigned int)];
+};
+
+struct SPSCQueue {
+    int* items;
+    unsigned int mask;          // capacity - 1
+    unsigned int batch;         // publish after this many operations
+    char pad[HEAP_CACHE_LINE - sizeof(int*) - 2 * sizeof(unsigned int)];
+    struct SPSCSide producer;
+    struct SPSCSide consumer;
+};
+
+#define SPSC_FULL  -1
+#define SPSC_EMPTY -1
+
+///////////////////////////////////////////////
+// Public interface: SPSC Circular Queue API
+///////////////////////////////////////////////
+
+// Room for capacity values (rounded up to a power of two); batch (1 .. capacity / 2)
+// is how many operations each side groups into one published index update.
+int initQueue_spsc(struct SPSCQueue* q, int capacity, int batch);
+void destroyQueue_spsc(struct SPSCQueue* q);
+
+// Producer thread only.
+int enQueue_spsc(struct SPSCQueue* q, int value);                // 0, or SPSC_FULL
+int enQueue_spsc_n(struct SPSCQueue* q, const int* values, int n);   // number of values queued
+void flushQueue_spsc(struct SPSCQueue* q);                       // publish pending values now
+
+// Consumer thread only.
+int deQueue_spsc(struct SPSCQueue* q, int* value);               // 0, or SPSC_EMPTY
+int deQueue_spsc_n(struct SPSCQueue* q, int* values, int max);   // number of values dequeued
+
+#endif
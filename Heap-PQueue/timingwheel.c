@@ -0,0 +1,273 @@
+// timingwheel.c : hierarchical timing wheel feeding a parcels queue.
+//////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "timingwheel.h"
+
+////////////////////////////////////////////////////////////
+//  Define private macros used by the timing wheel.
+////////////////////////////////////////////////////////////
+
+#define WHEEL_MASK  (WHEEL_SLOTS - 1)
+#define WHEEL_RANGE (1ULL << (WHEEL_LEVELS * WHEEL_BITS))                          // ticks the levels cover
+
+#define WHEEL_BATCH 64                                                              // ids taken out of a slot at a time
+#define WHEEL_KEEP  256                                                             // ring slots an emptied slot may keep
+
+#define wheel_index(due, level) ((int)((due) >> ((level) * WHEEL_BITS)) & WHEEL_MASK)
+
+#define wheel_span(level) (1ULL << ((level) * WHEEL_BITS))                          // ticks one slot of level covers
+
+static int wheel_alloc(TimingWheel* wheel) {
+
+    WheelTimer* timers;
+    int ntimers, id;
+
+    if (wheel->freet < 0) {                                                         // Grow x2; ids are indexes, so they survive.
+
+        ntimers = wheel->ntimers == 0 ? 64 : wheel->ntimers * 2;
+        if (wheel->ntimers > (1 << 30) || (timers = (WheelTimer*)realloc(wheel->timers, (size_t)ntimers * sizeof(WheelTimer))) == NULL)
+            return -1;
+
+        for (id = ntimers - 1; id >= wheel->ntimers; id--) {
+            timers[id].state = WHEEL_FREE;
+            timers[id].next = wheel->freet;
+            wheel->freet = id;
+        }
+        wheel->timers = timers;
+        wheel->ntimers = ntimers;
+    }
+
+    id = wheel->freet;
+    wheel->freet = wheel->timers[id].next;
+
+    return id;
+}
+
+static void wheel_free(TimingWheel* wheel, int id) {
+
+    wheel->timers[id].state = WHEEL_FREE;
+    wheel->timers[id].next = wheel->freet;
+    wheel->freet = id;
+}
+
+// Queue timer id in the slot its due tick falls in, as seen from now.
+static int wheel_place(TimingWheel* wheel, int id) {
+
+    unsigned long long due = wheel->timers[id].due;
+    unsigned long long delta;
+    int level;
+
+    if (due < wheel->now)
+        due = wheel->now;
+    if ((delta = due - wheel->now) >= WHEEL_RANGE) {                                // Park in the top level's furthest slot.
+        due = wheel->now + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS - 1 && delta >= wheel_span(level + 1); level++)
+        ;
+
+    if (enQueue(&wheel->slot[level][wheel_index(due, level)], id) != 0)
+        return -1;
+    wheel->queued[level]++;
+
+    return 0;
+}
+
+// Give the ring of an emptied slot back once a burst has blown it up.
+static void wheel_trim(struct Queue* q) {
+
+    if (q->capacity > WHEEL_KEEP)
+        shrinkQueue(q);
+}
+
+// Empty slot index of level into the levels below.
+static int wheel_cascade(TimingWheel* wheel, int level, int index) {
+
+    struct Queue* q = &wheel->slot[level][index];
+    int ids[WHEEL_BATCH];
+    int count, i;
+
+    while ((count = deQueue_n(q, ids, WHEEL_BATCH)) > 0) {
+
+        wheel->queued[level] -= count;
+        for (i = 0; i < count; i++) {
+
+            if (wheel->timers[ids[i]].state == WHEEL_CANCELLED)                     // Cancelled: the id is free to reuse now.
+                wheel_free(wheel, ids[i]);
+            else if (wheel_place(wheel, ids[i]) != 0) {
+                if (enQueue_n(q, ids + i, count - i) == 0)                          // Keep the rest here; the next advance retries.
+                    wheel->queued[level] += count - i;
+                return -1;
+            }
+            else
+                wheel->cascaded++;
+        }
+    }
+
+    wheel_trim(q);
+
+    return 0;
+}
+
+// Cascade where due, then deliver level 0's current slot and move to the next tick.
+static int wheel_tick(TimingWheel* wheel) {
+
+    unsigned long long now = wheel->now;
+    struct Queue* q = &wheel->slot[0][wheel_index(now, 0)];
+    WheelTimer* timer;
+    int ids[WHEEL_BATCH];
+    int delivered = 0;
+    int level, count, i;
+
+    for (level = 1; level < WHEEL_LEVELS && wheel_index(now, level - 1) == 0; level++)
+        if (wheel_cascade(wheel, level, wheel_index(now, level)) != 0)
+            return -1;
+
+    while ((count = deQueue_n(q, ids, WHEEL_BATCH)) > 0) {
+
+        wheel->queued[0] -= count;
+        for (i = 0; i < count; i++) {
+
+            timer = &wheel->timers[ids[i]];
+            if (timer->state == WHEEL_PENDING) {
+
+                if (put_parcel(wheel->out, &timer->parcel) != 0) {
+                    if (enQueue_n(q, ids + i, count - i) == 0)
+                        wheel->queued[0] += count - i;
+                    return -1;
+                }
+                wheel->size--;
+                wheel->fired++;
+                delivered++;
+            }
+            wheel_free(wheel, ids[i]);
+        }
+    }
+
+    wheel_trim(q);
+    wheel->now++;
+
+    return delivered;
+}
+
+///////////////////////////////////////////
+// Public interface: Timing Wheel API
+///////////////////////////////////////////
+// void wheel_init(TimingWheel* wheel, PQueue* out, unsigned long long now)
+// void wheel_destroy(TimingWheel* wheel)
+// int  wheel_schedule(TimingWheel* wheel, const Parcel* parcel, unsigned long long due, int* id)
+// int  wheel_cancel(TimingWheel* wheel, int id, Parcel* parcel)
+// int  wheel_advance(TimingWheel* wheel, unsigned long long now)
+///////////////////////////////////////////
+
+void wheel_init(TimingWheel* wheel, PQueue* out, unsigned long long now) {
+
+    int level, s;
+
+    memset(wheel, 0, sizeof(TimingWheel));
+
+    wheel->now = now;
+    wheel->out = out;
+    wheel->freet = -1;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (s = 0; s < WHEEL_SLOTS; s++)
+            initQueue(&wheel->slot[level][s]);
+
+    return;
+}
+
+void wheel_destroy(TimingWheel* wheel) {
+
+    int level, s;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (s = 0; s < WHEEL_SLOTS; s++)
+            destroyQueue(&wheel->slot[level][s]);
+
+    free(wheel->timers);
+
+    memset(wheel, 0, sizeof(TimingWheel));                                          // Clear the structure to be on the safe side.
+    wheel->freet = -1;
+
+    return;
+}
+
+int wheel_schedule(TimingWheel* wheel, const Parcel* parcel, unsigned long long due, int* id) {
+
+    WheelTimer* timer;
+    int tid;
+
+    if (id != NULL)
+        *id = -1;
+
+    if (due < wheel->now)                                                           // Already past: straight to dispatch.
+        return put_parcel(wheel->out, parcel);
+
+    if ((tid = wheel_alloc(wheel)) < 0)
+        return -1;
+
+    timer = &wheel->timers[tid];
+    timer->due = due;
+    memcpy(&timer->parcel, parcel, sizeof(Parcel));
+    timer->state = WHEEL_PENDING;
+
+    if (wheel_place(wheel, tid) != 0) {
+        wheel_free(wheel, tid);
+        return -1;
+    }
+
+    wheel->size++;
+    if (id != NULL)
+        *id = tid;
+
+    return 0;
+}
+
+int wheel_cancel(TimingWheel* wheel, int id, Parcel* parcel) {
+
+    if (id < 0 || id >= wheel->ntimers || wheel->timers[id].state != WHEEL_PENDING)
+        return -1;
+
+    if (parcel != NULL)
+        memcpy(parcel, &wheel->timers[id].parcel, sizeof(Parcel));
+
+    wheel->timers[id].state = WHEEL_CANCELLED;                                      // The slot drops it when it is emptied.
+    wheel->size--;
+
+    return 0;
+}
+
+int wheel_advance(TimingWheel* wheel, unsigned long long now) {
+
+    unsigned long long next;
+    int delivered = 0;
+    int level, count;
+
+    while (wheel->now <= now) {
+
+        if (wheel->size == 0) {                                                     // Nothing pending: jump. Slots may still hold
+            wheel->now = now + 1;                                                   // cancelled ids; they are dropped, not placed,
+            break;                                                                  // whenever their slot is emptied.
+        }
+
+        for (level = 0; level < WHEEL_LEVELS - 1 && wheel->queued[level] == 0; level++)
+            ;
+
+        if (level > 0 && wheel->now % wheel_span(level) != 0) {                    // Levels below are empty: nothing happens
+            next = (wheel->now | (wheel_span(level) - 1)) + 1;                      // before level cascades next.
+            wheel->now = next <= now ? next : now + 1;
+            continue;
+        }
+
+        if ((count = wheel_tick(wheel)) < 0)
+            return -1;
+        delivered += count;
+    }
+
+    return delivered;
+}
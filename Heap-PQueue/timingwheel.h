@@ -0,0 +1,92 @@
+// timingwheel.h - hierarchical timing wheel for parcels due at a given tick
+/////////////////////////////////////////////////////////////////////////////
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include "parcels.h"
+#include "cqueue.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// A timing wheel holds parcels until their due tick, then puts them into an ordinary
+// parcels queue (out) to be dispatched by priority. Time is an unsigned tick count
+// whose length is up to the caller (say 1 ms).
+//
+// There are WHEEL_LEVELS wheels of WHEEL_SLOTS slots. A timer due within 256 ticks
+// waits in level 0, in slot due & 255; one due within 256^2 ticks in level 1, slot
+// (due >> 8) & 255, and so on. Each time level 0 comes round to slot 0, the next slot
+// of level 1 is emptied into level 0 (and likewise up the levels): the cascade. A
+// timer therefore moves at most WHEEL_LEVELS - 1 times, and schedule, cancel and the
+// per-tick expiry are O(1) per timer, with no ordering among timers at all. While the
+// lower levels are empty, wheel_advance jumps straight to the next tick at which a
+// higher level cascades, so far-off timers cost nothing per idle tick.
+//
+// A slot is a circular queue (cqueue.h) of timer ids, so scheduling is an enQueue and
+// a slot is emptied with deQueue_n in batches. Cancel just marks the timer; its id
+// stays in the slot until the slot is emptied and is recycled only then.
+//
+// Timers due more than 2^32 ticks ahead wait in the last slot of the top level and
+// are placed again each time it cascades.
+////////////////////////////////////////////////////////////////////////////////////////////
+
+#define WHEEL_BITS   8
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+
+#define WHEEL_FREE      0
+#define WHEEL_PENDING   1
+#define WHEEL_CANCELLED 2
+
+typedef struct WheelTimer_ {
+
+	unsigned long long due;                                    // tick
+	Parcel parcel;
+	int state;                                                 // WHEEL_FREE / _PENDING / _CANCELLED
+	int next;                                                  // next free timer while WHEEL_FREE
+
+} WheelTimer;
+
+typedef struct TimingWheel_ {
+
+	unsigned long long now;                                    // every timer due before now has been delivered
+	PQueue* out;
+
+	int size;                                                  // pending timers
+	WheelTimer* timers;
+	int ntimers;                                               // timers allocated
+	int freet;                                                 // first free timer, -1 if none
+
+	int queued[WHEEL_LEVELS];                                  // ids in each level's slots, cancelled ones included
+
+	long long fired;
+	long long cascaded;                                        // timer moves between levels
+
+	struct Queue slot[WHEEL_LEVELS][WHEEL_SLOTS];
+
+} TimingWheel;
+
+///////////////////////////////////////////
+// Public interface: Timing Wheel API
+///////////////////////////////////////////
+
+// Deliver expired parcels to out (put_parcel), starting the clock at now.
+void wheel_init(TimingWheel* wheel, PQueue* out, unsigned long long now);
+
+// Drop all pending timers without delivering them.
+void wheel_destroy(TimingWheel* wheel);
+
+// Deliver parcel at tick due, passing back its timer id unless id is NULL. A parcel
+// due at a tick wheel_advance has already passed goes to out at once (id -1). Ids are
+// recycled once a timer has fired or its cancelled entry has been dropped.
+int wheel_schedule(TimingWheel* wheel, const Parcel* parcel, unsigned long long due, int* id);
+
+// Withdraw a pending timer, copying its parcel to parcel unless parcel is NULL.
+// Returns -1 if id is not pending (fired, cancelled or never scheduled).
+int wheel_cancel(TimingWheel* wheel, int id, Parcel* parcel);
+
+// Deliver every parcel due at or before tick now. Returns the number delivered, or
+// -1 if out could not take one (that parcel stays scheduled for the next call).
+int wheel_advance(TimingWheel* wheel, unsigned long long now);
+
+#define wheel_size(wheel) ((wheel)->size)
+
+#endif